@@ -0,0 +1,210 @@
+
+#include <mpi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "balance_game.h"
+
+// Split parts with the given cost and start so that every part gets the same
+// share of the cost, assuming the cost of a part is spread evenly over its
+// rows/cols. Parts keep at least min_size rows/cols.
+static void split_by_cost(
+  const double* restrict const cost, const int* restrict const start,
+  const int parts, const int min_size, int* restrict const new_start)
+{
+  double total = 0.0;
+  for (int i = 0; i < parts; i++) {
+    total += cost[i];
+  }
+
+  new_start[0] = 0;
+  new_start[parts] = start[parts];
+
+  int part = 0;
+  double before = 0.0;
+  for (int k = 1; k < parts; k++) {
+    const double target = total * k / parts;
+    while (part < parts - 1 && before + cost[part] < target) {
+      before += cost[part];
+      part++;
+    }
+
+    double fraction = cost[part] > 0.0 ? (target - before) / cost[part] : 0.0;
+    fraction = fraction < 0.0 ? 0.0 : (fraction > 1.0 ? 1.0 : fraction);
+    const double split = start[part] + fraction * (start[part + 1] - start[part]);
+
+    new_start[k] = (int)(start[k] + (split - start[k]) / 2 + 0.5);
+  }
+
+  for (int k = 1; k < parts; k++) {
+    if (new_start[k] < new_start[k - 1] + min_size) {
+      new_start[k] = new_start[k - 1] + min_size;
+    }
+  }
+  for (int k = parts - 1; k > 0; k--) {
+    if (new_start[k] > new_start[k + 1] - min_size) {
+      new_start[k] = new_start[k + 1] - min_size;
+    }
+  }
+}
+
+// Subarray of the padded tile starting at tile_start holding the global
+// rows/cols [begin, end), returns false if that is empty
+static inline bool overlap_type(
+  const GameInfo* const game,
+  const int* restrict const tile_start, const int* restrict const tile_size,
+  const int* restrict const begin, const int* restrict const end,
+  MPI_Datatype* const type)
+{
+  if (begin[0] >= end[0] || begin[1] >= end[1]) {
+    *type = MPI_C_BOOL;
+    return false;
+  }
+
+  int padded_size[] = {tile_size[0] + 2 * game->halo, tile_size[1] + 2 * game->halo};
+  int block_size[] = {end[0] - begin[0], end[1] - begin[1]};
+  int block_offset[] = {begin[0] - tile_start[0] + game->halo,
+                        begin[1] - tile_start[1] + game->halo};
+  MPI_Type_create_subarray(2, padded_size, block_size, block_offset,
+                           MPI_ORDER_C, MPI_C_BOOL, type);
+  MPI_Type_commit(type);
+  return true;
+}
+
+static inline int max_int(const int a, const int b) { return a > b ? a : b; }
+static inline int min_int(const int a, const int b) { return a < b ? a : b; }
+
+// Send every rank the part of the old tile that lies in its new tile. With
+// small boundary shifts only neighbours exchange cells, the other counts are
+// zero.
+static void migrate_cells(
+  const GameInfo* const game,
+  const int* restrict const old_row_start, const int* restrict const old_col_start,
+  const bool* restrict const old_tile, bool* restrict const new_tile)
+{
+  int size;
+  MPI_Comm_size(game->communicator, &size);
+
+  const int* const coords = game->coords;
+  const int old_start[] = {old_row_start[coords[0]], old_col_start[coords[1]]};
+  const int old_end[] = {old_row_start[coords[0] + 1], old_col_start[coords[1] + 1]};
+  const int old_size[] = {old_end[0] - old_start[0], old_end[1] - old_start[1]};
+  const int new_start[] = {game->row_start[coords[0]], game->col_start[coords[1]]};
+  const int new_end[] = {game->row_start[coords[0] + 1], game->col_start[coords[1] + 1]};
+  const int new_size[] = {new_end[0] - new_start[0], new_end[1] - new_start[1]};
+
+  int* const counts = (int*)malloc(4 * size * sizeof(int));
+  int* const send_counts = &counts[0 * size];
+  int* const recv_counts = &counts[1 * size];
+  int* const displacements = &counts[2 * size];
+  MPI_Datatype* const types = (MPI_Datatype*)malloc(2 * size * sizeof(MPI_Datatype));
+  MPI_Datatype* const send_types = &types[0];
+  MPI_Datatype* const recv_types = &types[size];
+
+  for (int peer = 0; peer < size; peer++) {
+    int peer_coords[2];
+    MPI_Cart_coords(game->communicator, peer, 2, peer_coords);
+    displacements[peer] = 0;
+
+    // My old tile within the peers new tile
+    const int send_begin[] = {
+      max_int(old_start[0], game->row_start[peer_coords[0]]),
+      max_int(old_start[1], game->col_start[peer_coords[1]])
+    };
+    const int send_end[] = {
+      min_int(old_end[0], game->row_start[peer_coords[0] + 1]),
+      min_int(old_end[1], game->col_start[peer_coords[1] + 1])
+    };
+    send_counts[peer] = overlap_type(game, old_start, old_size, send_begin, send_end,
+                                     &send_types[peer]);
+
+    // The peers old tile within my new tile
+    const int recv_begin[] = {
+      max_int(new_start[0], old_row_start[peer_coords[0]]),
+      max_int(new_start[1], old_col_start[peer_coords[1]])
+    };
+    const int recv_end[] = {
+      min_int(new_end[0], old_row_start[peer_coords[0] + 1]),
+      min_int(new_end[1], old_col_start[peer_coords[1] + 1])
+    };
+    recv_counts[peer] = overlap_type(game, new_start, new_size, recv_begin, recv_end,
+                                     &recv_types[peer]);
+  }
+
+  MPI_Alltoallw(old_tile, send_counts, displacements, send_types,
+                new_tile, recv_counts, displacements, recv_types,
+                game->communicator);
+
+  for (int peer = 0; peer < size; peer++) {
+    if (send_counts[peer]) MPI_Type_free(&send_types[peer]);
+    if (recv_counts[peer]) MPI_Type_free(&recv_types[peer]);
+  }
+
+  free(counts);
+  free(types);
+}
+
+bool balance_game(GameInfo* const game, const double update_time)
+{
+  int size;
+  MPI_Comm_size(game->communicator, &size);
+
+  double* const times = (double*)malloc(size * sizeof(double));
+  MPI_Allgather(&update_time, 1, MPI_DOUBLE, times, 1, MPI_DOUBLE, game->communicator);
+
+  // Sum the time per process row and column
+  const int* const dims = game->node_dims;
+  double* const row_cost = (double*)calloc(dims[0] + dims[1], sizeof(double));
+  double* const col_cost = &row_cost[dims[0]];
+  double mean = 0.0, max = 0.0;
+
+  for (int rank = 0; rank < size; rank++) {
+    int coords[2];
+    MPI_Cart_coords(game->communicator, rank, 2, coords);
+    row_cost[coords[0]] += times[rank];
+    col_cost[coords[1]] += times[rank];
+    mean += times[rank] / size;
+    max = times[rank] > max ? times[rank] : max;
+  }
+
+  int* const row_start = (int*)malloc((dims[0] + 1) * sizeof(int));
+  int* const col_start = (int*)malloc((dims[1] + 1) * sizeof(int));
+  split_by_cost(row_cost, game->row_start, dims[0], game->halo, row_start);
+  split_by_cost(col_cost, game->col_start, dims[1], game->halo, col_start);
+
+  free(times);
+  free(row_cost);
+
+  // Every rank computed the same boundaries from the same times
+  if (max <= mean * BALANCE_MIN_IMBALANCE ||
+      (memcmp(row_start, game->row_start, (dims[0] + 1) * sizeof(int)) == 0 &&
+       memcmp(col_start, game->col_start, (dims[1] + 1) * sizeof(int)) == 0)) {
+    free(row_start);
+    free(col_start);
+    return false;
+  }
+
+  int* const old_row_start = game->row_start;
+  int* const old_col_start = game->col_start;
+  game->row_start = row_start;
+  game->col_start = col_start;
+
+  const int new_rows = row_start[game->coords[0] + 1] - row_start[game->coords[0]];
+  const int new_cols = col_start[game->coords[1] + 1] - col_start[game->coords[1]];
+  bool* const new_tile = (bool*)calloc((new_rows + 2 * game->halo) * (new_cols + 2 * game->halo),
+                                       sizeof(bool));
+
+  // The old tile size is still in game until retile_game()
+  bool* const old_tile = acquire_tile(game);
+  migrate_cells(game, old_row_start, old_col_start, old_tile, new_tile);
+  release_tile(game, old_tile, false);
+
+  retile_game(game, new_tile);
+
+  free(new_tile);
+  free(old_row_start);
+  free(old_col_start);
+  return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "initialize_game.h"
+
+// Tiles are only moved once the slowest rank takes this much longer than
+// the mean
+#define BALANCE_MIN_IMBALANCE 1.05
+
+// Shift the row and column boundaries of the tiles such that the update time
+// each rank measured since the last call is spread evenly, and migrate the
+// cells to their new ranks. The decomposition stays a grid, so a process row
+// gets rows by the summed time of its ranks and a process column columns by
+// the summed time of its ranks. Boundaries move halfway to their target per
+// call, which damps oscillations from noisy timings. Collective, returns
+// whether the tiles changed.
+bool balance_game(GameInfo* const game, const double update_time);
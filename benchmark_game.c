@@ -0,0 +1,56 @@
+
+#include <mpi.h>
+#include <stdio.h>
+
+#include "initialize_game.h"
+#include "benchmark_game.h"
+
+const char* const PHASE_NAMES[PHASE_COUNT + 1] = {
+  "synchronize", "update", "io", "balance", "detect", "total"
+};
+
+void report_benchmark(
+  const GameTimer* const timer, const GameInfo* const game,
+  const long generations, const int threads, const double baseline)
+{
+  int rank, size;
+  MPI_Comm_rank(game->communicator, &rank);
+  MPI_Comm_size(game->communicator, &size);
+
+  // The phases and the total in one go
+  double times[PHASE_COUNT + 1];
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    times[i] = timer->phase[i];
+  }
+  times[PHASE_COUNT] = timer->total;
+
+  double min[PHASE_COUNT + 1], max[PHASE_COUNT + 1], sum[PHASE_COUNT + 1];
+  MPI_Reduce(times, min, PHASE_COUNT + 1, MPI_DOUBLE, MPI_MIN, 0, game->communicator);
+  MPI_Reduce(times, max, PHASE_COUNT + 1, MPI_DOUBLE, MPI_MAX, 0, game->communicator);
+  MPI_Reduce(times, sum, PHASE_COUNT + 1, MPI_DOUBLE, MPI_SUM, 0, game->communicator);
+
+  if (rank != 0) {
+    return;
+  }
+
+  const double cells = (double)game->global_rows * game->global_cols;
+  const double wall = max[PHASE_COUNT];
+  const double updates = wall > 0.0 ? cells * generations / wall : 0.0;
+
+  printf("benchmark: %d x %d cells, %d ranks (%d x %d), %d threads per rank, %ld generations\n",
+         game->global_rows, game->global_cols, size,
+         game->node_dims[0], game->node_dims[1], threads, generations);
+  printf("%-12s %12s %12s %12s\n", "phase [s]", "min", "mean", "max");
+  for (int i = 0; i <= PHASE_COUNT; i++) {
+    printf("%-12s %12.6f %12.6f %12.6f\n",
+           PHASE_NAMES[i], min[i], sum[i] / size, max[i]);
+  }
+
+  printf("cell updates/s: %.4e (%.4e per rank)\n", updates, updates / size);
+  if (wall > 0.0) {
+    printf("update efficiency: %.1f%%\n", 100.0 * sum[PHASE_UPDATE] / size / wall);
+  }
+  if (baseline > 0.0) {
+    printf("parallel efficiency: %.1f%%\n", 100.0 * updates / size / baseline);
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <mpi.h>
+
+#include "initialize_game.h"
+#include "trace_game.h"
+
+enum GamePhase {
+  PHASE_SYNCHRONIZE,  // halo exchange
+  PHASE_UPDATE,       // kernel
+  PHASE_IO,           // printing, snapshots and checkpoints
+  PHASE_BALANCE,      // load balancing
+  PHASE_DETECT,       // board hashing for cycle detection
+  PHASE_COUNT
+};
+
+// Names of the phases followed by "total"
+extern const char* const PHASE_NAMES[PHASE_COUNT + 1];
+
+// Wall clock time spent by this rank in each phase since reset_timer()
+typedef struct GameTimer {
+  double phase[PHASE_COUNT];
+  double begin;
+  double total;
+} GameTimer;
+
+static inline void reset_timer(GameTimer* const timer)
+{
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    timer->phase[i] = 0.0;
+  }
+  timer->total = 0.0;
+  timer->begin = MPI_Wtime();
+}
+
+// Add the time since start to the phase and return the current time, so
+// consecutive phases can be chained. Traces record every phase from here.
+static inline double add_phase_time(
+  GameTimer* const timer, const enum GamePhase phase, const double start)
+{
+  const double now = MPI_Wtime();
+  timer->phase[phase] += now - start;
+  TRACE_PHASE(phase, start, now);
+  return now;
+}
+
+static inline void stop_timer(GameTimer* const timer)
+{
+  timer->total = MPI_Wtime() - timer->begin;
+}
+
+// Reduce the timers over all ranks and print min/mean/max per phase, cell
+// updates per second and the parallel efficiency on rank 0. The efficiency
+// is the mean update time over the max total time, and if baseline (cell
+// updates per second of a single rank) is positive also the throughput per
+// rank relative to it.
+void report_benchmark(
+  const GameTimer* const timer, const GameInfo* const game,
+  const long generations, const int threads, const double baseline);
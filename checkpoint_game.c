@@ -0,0 +1,199 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "checkpoint_game.h"
+
+static const char CHECKPOINT_MAGIC[8] = {'G', 'O', 'L', 'C', 'K', 'P', 'T', '\0'};
+static const int32_t CHECKPOINT_VERSION = 2;
+
+// Version 1 files predate Generations rules, their states field is reserved
+static const int32_t CHECKPOINT_VERSION_LIFE = 1;
+
+// The file view selects the tile in the global board, using the same
+// subarray geometry as scatter_matrix(), the memory type selects the tile
+// inside the padded tile.
+static inline void set_tile_view(
+  const MPI_File file, const GameInfo* const game,
+  MPI_Datatype* const file_type, MPI_Datatype* const tile_type)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  int global_size[] = {game->global_rows, game->global_cols};
+  MPI_Type_create_subarray(2, global_size, tile_size, tile_offset,
+                           MPI_ORDER_C, MPI_UINT8_T, file_type);
+  MPI_Type_commit(file_type);
+
+  int padded_size[] = {game->local_rows + 2 * game->halo, padded_cols(game)};
+  int local_offset[] = {game->halo, game->halo};
+  MPI_Type_create_subarray(2, padded_size, tile_size, local_offset,
+                           MPI_ORDER_C, MPI_UINT8_T, tile_type);
+  MPI_Type_commit(tile_type);
+
+  MPI_File_set_view(file, sizeof(struct CheckpointHeader), MPI_UINT8_T, *file_type,
+                    "native", MPI_INFO_NULL);
+}
+
+// Cell states of the padded byte tile, a copy with the dying cells merged in
+// for Generations rules
+static inline uint8_t* tile_states(const GameInfo* const game, bool* const tile)
+{
+  if (game->decay == NULL) {
+    return (uint8_t*)tile;
+  }
+
+  const size_t cells = (size_t)(game->local_rows + 2 * game->halo) * padded_cols(game);
+  uint8_t* const states = (uint8_t*)malloc(cells);
+  for (size_t i = 0; i < cells; i++) {
+    states[i] = game->decay[i] ? game->decay[i] + 1 : tile[i];
+  }
+  return states;
+}
+
+static inline void split_states(GameInfo* const game, bool* const tile, uint8_t* const states)
+{
+  if (game->decay == NULL) {
+    return;
+  }
+
+  const size_t cells = (size_t)(game->local_rows + 2 * game->halo) * padded_cols(game);
+  for (size_t i = 0; i < cells; i++) {
+    tile[i] = states[i] == 1;
+    game->decay[i] = states[i] > 1 ? states[i] - 1 : 0;
+  }
+  free(states);
+}
+
+// Read the header of either version, version 1 files get two states
+static int read_header(const MPI_File file, struct CheckpointHeader* const header)
+{
+  int ierror = MPI_File_read_at_all(file, 0, header, sizeof(*header), MPI_BYTE,
+                                    MPI_STATUS_IGNORE);
+  if (ierror != MPI_SUCCESS ||
+      memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+      header->rows <= 0 || header->cols <= 0) {
+    return 1;
+  }
+
+  if (header->version == CHECKPOINT_VERSION_LIFE) {
+    header->states = 2;
+  } else if (header->version != CHECKPOINT_VERSION) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int read_checkpoint_header(
+  const char* const path, struct CheckpointHeader* const header,
+  const GameRule* const rule, const MPI_Comm communicator)
+{
+  MPI_File file;
+  if (MPI_File_open(communicator, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    return 1;
+  }
+
+  int ierror = read_header(file, header);
+  MPI_File_close(&file);
+
+  // The dying states of the cells only make sense for the same rule
+  if (ierror || header->states != rule->states) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int write_checkpoint(GameInfo* const game, const char* const path, const long generation)
+{
+  char* const temp_path = malloc(strlen(path) + 5);
+  sprintf(temp_path, "%s.tmp", path);
+
+  MPI_File file;
+  int ierror = MPI_File_open(game->communicator, temp_path,
+                             MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+  if (ierror != MPI_SUCCESS) {
+    free(temp_path);
+    return ierror;
+  }
+
+  // Drop the tail of any longer file that was there before
+  MPI_File_set_size(file, 0);
+
+  if (game->rank == 0) {
+    struct CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.rows = game->global_rows;
+    header.cols = game->global_cols;
+    header.states = game->rule.states;
+    header.generation = generation;
+
+    MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+  }
+
+  MPI_Datatype file_type, tile_type;
+  set_tile_view(file, game, &file_type, &tile_type);
+
+  bool* const tile = acquire_tile(game);
+  uint8_t* const states = tile_states(game, tile);
+  ierror = MPI_File_write_all(file, states, 1, tile_type, MPI_STATUS_IGNORE);
+  if (states != (uint8_t*)tile) {
+    free(states);
+  }
+  release_tile(game, tile, false);
+
+  MPI_File_close(&file);
+  MPI_Type_free(&file_type);
+  MPI_Type_free(&tile_type);
+
+  // Only replace the previous checkpoint once every rank has written
+  MPI_Allreduce(MPI_IN_PLACE, &ierror, 1, MPI_INT, MPI_MAX, game->communicator);
+  if (ierror == MPI_SUCCESS && game->rank == 0) {
+    ierror = rename(temp_path, path) == 0 ? MPI_SUCCESS : 1;
+  }
+  MPI_Bcast(&ierror, 1, MPI_INT, 0, game->communicator);
+
+  free(temp_path);
+  return ierror;
+}
+
+int read_checkpoint(GameInfo* const game, const char* const path)
+{
+  MPI_File file;
+  if (MPI_File_open(game->communicator, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    return 1;
+  }
+
+  struct CheckpointHeader header;
+  int ierror = read_header(file, &header);
+  if (ierror || header.rows != game->global_rows || header.cols != game->global_cols ||
+      header.states != game->rule.states) {
+    MPI_File_close(&file);
+    return 1;
+  }
+
+  MPI_Datatype file_type, tile_type;
+  set_tile_view(file, game, &file_type, &tile_type);
+
+  bool* const tile = acquire_tile(game);
+  uint8_t* const states = tile_states(game, tile);
+  ierror = MPI_File_read_all(file, states, 1, tile_type, MPI_STATUS_IGNORE);
+  split_states(game, tile, states);
+  release_tile(game, tile, true);
+
+  MPI_File_close(&file);
+  MPI_Type_free(&file_type);
+  MPI_Type_free(&tile_type);
+
+  // Every rank has to see the failure to clean up collectively
+  MPI_Allreduce(MPI_IN_PLACE, &ierror, 1, MPI_INT, MPI_MAX, game->communicator);
+  return ierror;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mpi.h>
+#include <stdint.h>
+
+#include "initialize_game.h"
+
+// Checkpoint files start with a fixed size header, followed by the global
+// board in row major order with one byte per cell: 0 for dead and 1 for live
+// cells, dying cells of Generations rules count up from 2. Each rank reads
+// and writes its own tile through an MPI-IO file view, so the board never
+// has to fit in the memory of a single rank.
+struct CheckpointHeader {
+  char magic[8];
+  int32_t version;
+  int32_t rows;
+  int32_t cols;
+  int32_t states;  // of the rule, since version 2
+  int64_t generation;
+};
+
+// Read the header collectively, so the board size is known before
+// initialize_game(). Fails if the checkpoint has another number of states
+// than the rule.
+int read_checkpoint_header(
+  const char* const path, struct CheckpointHeader* const header,
+  const GameRule* const rule, const MPI_Comm communicator);
+
+// Collectively write/read the current generation of the game. The file is
+// written to a temporary name and renamed once complete, so a crash never
+// leaves a partial checkpoint behind.
+int write_checkpoint(GameInfo* const game, const char* const path, const long generation);
+int read_checkpoint(GameInfo* const game, const char* const path);
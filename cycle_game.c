@@ -0,0 +1,190 @@
+#include <mpi.h>
+#include <stdlib.h>
+
+#include "cycle_game.h"
+#include "initialize_game.h"
+#include "packed_game.h"
+#include "rule_game.h"
+
+// Row hash of global row r, odd so that no row sum is lost
+static inline uint64_t row_hash(const int r)
+{
+  return splitmix64(2 * (uint64_t)r + 1) | 1;
+}
+
+// Each row sums the column hashes of its cells times their state, and the
+// board sums the row sums times their row hash. That's linear in the cells,
+// so tiles splitting a row add up to the same hash, and the inner loop is
+// a table lookup the compiler vectorizes instead of a hash per cell.
+static void hash_byte_tile(
+  const CycleDetector* const detector, const GameInfo* const game,
+  uint64_t* const hash, uint64_t* const population)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  const int cols_pad = padded_cols(game);
+  const uint8_t* const tile = (const uint8_t*)game->current;
+  const uint8_t* const decay = game->decay;
+  const uint64_t* restrict const columns = &detector->columns[tile_offset[1]];
+  uint64_t sum = 0, live = 0;
+
+  #pragma omp parallel for schedule(static) reduction(+:sum, live)
+  for (int r = 0; r < tile_size[0]; r++) {
+    const uint8_t* restrict const cells = &tile[(r + game->halo) * cols_pad + game->halo];
+    uint64_t row = 0, count = 0;
+
+    if (decay == NULL) {
+      for (int c = 0; c < tile_size[1]; c++) {
+        row += columns[c] & -(uint64_t)cells[c];
+        count += cells[c];
+      }
+    } else {
+      // Dying cells count with their state, live cells are state 1
+      const uint8_t* restrict const ages = &decay[(r + game->halo) * cols_pad + game->halo];
+      for (int c = 0; c < tile_size[1]; c++) {
+        row += columns[c] * (cells[c] + 2 * (uint64_t)ages[c]);
+        count += cells[c];
+      }
+    }
+
+    sum += row * row_hash(tile_offset[0] + r);
+    live += count;
+  }
+
+  *hash = sum;
+  *population = live;
+}
+
+static void hash_packed_tile(
+  const CycleDetector* const detector, const GameInfo* const game,
+  uint64_t* const hash, uint64_t* const population)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  const int words = game->packed_cols;
+  const uint64_t* restrict const columns = &detector->columns[tile_offset[1]];
+  uint64_t sum = 0, live = 0;
+
+  #pragma omp parallel for schedule(static) reduction(+:sum, live)
+  for (int r = 1; r <= tile_size[0]; r++) {
+    const uint64_t* const cells = &game->packed_current[r * words];
+    uint64_t row = 0;
+
+    for (int w = 0; w < words; w++) {
+      uint64_t bits = cells[w];
+
+      // Only tile columns, the halo bits are refilled by the exchange
+      if (w == 0) {
+        bits &= ~(uint64_t)1;
+      }
+
+      while (bits != 0) {
+        const int col = w * PACKED_WORD_BITS + __builtin_ctzll(bits);
+        bits &= bits - 1;
+        if (col > tile_size[1]) {
+          break;
+        }
+        row += columns[col - 1];
+        live++;
+      }
+    }
+
+    sum += row * row_hash(tile_offset[0] + r - 1);
+  }
+
+  *hash = sum;
+  *population = live;
+}
+
+void initialize_cycle_detector(
+  CycleDetector* const detector, const GameInfo* const game, const int every)
+{
+  detector->every = every;
+  detector->pending = 0;
+  detector->local = (uint64_t*)malloc(2 * every * sizeof(uint64_t));
+
+  detector->columns = (uint64_t*)malloc(game->global_cols * sizeof(uint64_t));
+  for (int c = 0; c < game->global_cols; c++) {
+    detector->columns[c] = splitmix64(2 * (uint64_t)c);
+  }
+
+  detector->first = 0;
+  detector->recorded = 0;
+  detector->settled = 0;
+  detector->period = 0;
+  detector->extinct = false;
+}
+
+void destroy_cycle_detector(CycleDetector* const detector)
+{
+  free(detector->local);
+  free(detector->columns);
+  detector->local = NULL;
+  detector->columns = NULL;
+}
+
+// Add the global hash of generation and look for the shortest period that
+// reaches back to an equal board
+static inline bool record_generation(
+  CycleDetector* const detector, const long generation,
+  const uint64_t hash, const uint64_t population)
+{
+  const int slot = generation % CYCLE_HISTORY;
+  detector->hash[slot] = hash;
+  detector->population[slot] = population;
+  detector->recorded++;
+
+  if (population == 0) {
+    detector->settled = generation;
+    detector->period = 1;
+    detector->extinct = true;
+    return true;
+  }
+
+  const long reach = detector->recorded < CYCLE_HISTORY ? detector->recorded : CYCLE_HISTORY;
+  for (int period = 1; period < reach; period++) {
+    const int earlier = (generation - period) % CYCLE_HISTORY;
+    if (detector->hash[earlier] == hash && detector->population[earlier] == population) {
+      detector->settled = generation - period;
+      detector->period = period;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool detect_cycle(CycleDetector* const detector, GameInfo* const game, const long generation)
+{
+  if (detector->pending == 0) {
+    detector->first = generation;
+  }
+
+  uint64_t* const local = &detector->local[2 * detector->pending++];
+  if (game->storage == GAME_STORAGE_PACKED) {
+    hash_packed_tile(detector, game, &local[0], &local[1]);
+  } else {
+    hash_byte_tile(detector, game, &local[0], &local[1]);
+  }
+
+  if (detector->pending < detector->every) {
+    return false;
+  }
+
+  // Hashes add up modulo 2^64, like the populations
+  const int count = detector->pending;
+  detector->pending = 0;
+  MPI_Allreduce(MPI_IN_PLACE, detector->local, 2 * count, MPI_UINT64_T, MPI_SUM,
+                game->communicator);
+
+  for (int i = 0; i < count; i++) {
+    if (record_generation(detector, detector->first + i,
+                          detector->local[2 * i], detector->local[2 * i + 1])) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+
+// The board hash is a sum over all non-dead cells of the hashes of their
+// global row and column times their state. Sums don't depend on the
+// decomposition, so every rank hashes its own tile and one allreduce adds
+// them up, also after the tiles were rebalanced. The hashes of the last CYCLE_HISTORY
+// generations are kept to find periods up to CYCLE_HISTORY - 1.
+#define CYCLE_HISTORY 1024
+
+typedef struct CycleDetector {
+  // generations per allreduce, and the local hash and population of each
+  // generation since the last one
+  int every;
+  int pending;
+  uint64_t* restrict local;
+
+  // hash of every global column
+  uint64_t* restrict columns;
+
+  // global hash and population of the last generations, indexed by
+  // generation % CYCLE_HISTORY, and the generations recorded
+  uint64_t hash[CYCLE_HISTORY];
+  uint64_t population[CYCLE_HISTORY];
+  long first;
+  long recorded;
+
+  // generation from which the board repeats with period, 0 until then.
+  // Extinct boards have period 1 and no population.
+  long settled;
+  int period;
+  bool extinct;
+} CycleDetector;
+
+static inline uint64_t splitmix64(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+void initialize_cycle_detector(
+  CycleDetector* const detector, const GameInfo* const game, const int every);
+void destroy_cycle_detector(CycleDetector* const detector);
+
+// Hash the current generation of the game. Every detector->every calls the
+// hashes are combined over all ranks and compared with the history. Returns
+// true on all ranks once the board died out or repeats, with settled and
+// period filled in.
+bool detect_cycle(CycleDetector* const detector, GameInfo* const game, const long generation);
@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "initialize_game.h"
+#include "debug_game.h"
+#include "packed_game.h"
+
+static const int GATHER_TAG = 21;
 
 void print_matrix(const bool* const restrict game, const int rows, const int cols) {
   char digits[] = {'0', '1'};
@@ -23,71 +28,164 @@ void print_matrix(const bool* const restrict game, const int rows, const int col
   free(outdata);
 }
 
-static inline int gatter_matrix(
-  const bool* restrict const local_matrix , const int local_rows , const int local_cols ,
-        bool* restrict const global_matrix, const int global_rows, const int global_cols,
-  const int* restrict const dims, const int recv_rank, const MPI_Comm communicator)
+// Node leaders collect the tiles of their node back to back, in node rank
+// order, and pass them on to rank 0 as one message, so rank 0 receives one
+// message per node instead of one per rank
+static int gather_by_node(
+  const bool* restrict const local_matrix,
+        bool* restrict const global_matrix,
+  GameInfo* const game)
 {
-  // Define data type that will have appropiate block and stride length for
-  // each sub matrix.
-  MPI_Datatype send_blocktype;
-  MPI_Datatype send_blocktype_vec;
-  MPI_Type_vector(local_rows, local_cols, local_cols + 2, MPI_C_BOOL, &send_blocktype_vec);
-  MPI_Type_create_resized(send_blocktype_vec, 0, sizeof(bool), &send_blocktype);
-  MPI_Type_commit(&send_blocktype);
-
-  MPI_Datatype recv_blocktype;
-  MPI_Datatype recv_blocktype_vec;
-  MPI_Type_vector(local_rows, local_cols, global_cols, MPI_C_BOOL, &recv_blocktype_vec);
-  MPI_Type_create_resized(recv_blocktype_vec, 0, sizeof(bool), &recv_blocktype);
-  MPI_Type_commit(&recv_blocktype);
-
-  // Create displacement and count matrix for scatterv
-  const int size = dims[0] * dims[1];
-  int* restrict const disp = malloc(size * sizeof(int));
-  int* restrict const count = malloc(size * sizeof(int));
-
-  for (int rank = 0; rank < size; rank++) {
-    int coords[2] = {0, 0};
-    MPI_Cart_coords(communicator, rank, 2, coords);
-
-    count[rank] = 1;
-    disp[rank] = coords[0] * global_cols * local_rows + coords[1] * local_cols;
+  struct GatherCache* const gather = &game->gather;
+  MPI_Request* restrict const request = gather->requests;
+  int requests = 0;
+
+  int node_rank, node_size;
+  MPI_Comm_rank(gather->node, &node_rank);
+  MPI_Comm_size(gather->node, &node_size);
+
+  // Rank 0 receives every node with a struct of the tiles of its ranks
+  if (game->rank == 0) {
+    for (int k = 0; k < gather->nodes; k++) {
+      MPI_Irecv(global_matrix, 1, gather->node_types[k],
+                gather->node_members[gather->node_start[k]], GATHER_TAG,
+                game->communicator, &request[requests++]);
+    }
+  }
+
+  // Leaders receive the tiles of their node, their own included
+  const int node_requests = requests;
+  int node_cells = 0;
+  if (node_rank == 0) {
+    for (int i = 0; i < node_size; i++) {
+      int tile_offset[2], tile_size[2];
+      rank_tile(game, gather->node_members[i], tile_offset, tile_size);
+      MPI_Irecv(&gather->node_buffer[node_cells], tile_size[0] * tile_size[1], MPI_C_BOOL,
+                i, GATHER_TAG, gather->node, &request[requests++]);
+      node_cells += tile_size[0] * tile_size[1];
+    }
+  }
+
+  int ierror = MPI_Send(local_matrix, 1, gather->tile_type, 0, GATHER_TAG, gather->node);
+
+  if (node_rank == 0) {
+    MPI_Waitall(requests - node_requests, &request[node_requests], MPI_STATUSES_IGNORE);
+
+    MPI_Request send_request;
+    ierror |= MPI_Isend(gather->node_buffer, node_cells, MPI_C_BOOL, 0, GATHER_TAG,
+                        game->communicator, &send_request);
+    MPI_Waitall(node_requests, request, MPI_STATUSES_IGNORE);
+    MPI_Wait(&send_request, MPI_STATUS_IGNORE);
+  }
+
+  return ierror;
+}
+
+// Counterpart of scatter_matrix() in initialize_game.c, the receiver posts one
+// receive with a subarray type per rank as tiles may differ in size.
+int gatter_matrix(
+  const bool* restrict const local_matrix,
+        bool* restrict const global_matrix,
+  GameInfo* const game, const int recv_rank)
+{
+  if (game->gather.by_node && recv_rank == 0) {
+    return gather_by_node(local_matrix, global_matrix, game);
+  }
+
+  int rank, size;
+  MPI_Comm_rank(game->communicator, &rank);
+  MPI_Comm_size(game->communicator, &size);
+
+  // Receive each ranks block into the global matrix
+  MPI_Request* restrict const recv_request = game->gather.requests;
+  if (rank == recv_rank) {
+    const MPI_Datatype* const recv_types = game->gather.board_types;
+    for (int source = 0; source < size; source++) {
+      MPI_Irecv(global_matrix, 1, recv_types[source], source, GATHER_TAG,
+                game->communicator, &recv_request[source]);
+    }
   }
 
-  // Scatter data
-  int ierror = MPI_Gatherv(&local_matrix[(local_cols + 2) + 1], 1, send_blocktype,
-                           global_matrix, count, disp, recv_blocktype,
-                           recv_rank, communicator);
+  int ierror = MPI_Send(local_matrix, 1, game->gather.tile_type, recv_rank, GATHER_TAG,
+                        game->communicator);
 
-  // Free buffers and types
-  free(disp);
-  free(count);
-  MPI_Type_free(&send_blocktype_vec);
-  MPI_Type_free(&send_blocktype);
-  MPI_Type_free(&recv_blocktype_vec);
-  MPI_Type_free(&recv_blocktype);
+  if (rank == recv_rank) {
+    MPI_Waitall(size, recv_request, MPI_STATUSES_IGNORE);
+  }
 
   // Report errors
   return ierror;
 }
 
 void print_global_game(GameInfo* game, const int rank) {
-  // Gather the full game on rank 0
-  bool* full_game = NULL;
-  if (rank == 0) {
-    full_game = (bool*)calloc(game->global_rows * game->global_cols, sizeof(bool));
-  }
+  // Packed games don't keep a byte tile, so expand a temporary one
+  bool* const local_game = acquire_tile(game);
 
-  gatter_matrix(game->current, game->local_rows, game->local_cols,
-                full_game, game->global_rows, game->global_cols,
-                game->node_dims, 0, game->communicator);
+  // Gather the full game on rank 0, into the board kept for that
+  bool* const full_game = rank == 0 ? game->gather.board : NULL;
+  gatter_matrix(local_game, full_game, game, 0);
 
-  // rank 0 print full game and free
+  // rank 0 print full game
   if (rank == 0) {
     printf("full_game:\n");
     print_matrix(full_game, game->global_rows, game->global_cols);
     fflush(stdout);
-    free(full_game);
   }
+
+  release_tile(game, local_game, false);
+}
+
+unsigned long long local_population(GameInfo* const game)
+{
+  unsigned long long population = 0;
+
+  // Packed rows hold the west halo in bit 0 and the tile in bits 1 to
+  // local_cols
+  if (game->storage == GAME_STORAGE_PACKED) {
+    const int words = game->packed_cols;
+    for (int r = 1; r <= game->local_rows; r++) {
+      const uint64_t* const row = &game->packed_current[r * words];
+      for (int w = 0; w < words; w++) {
+        uint64_t bits = row[w];
+        if (w == 0) {
+          bits &= ~(uint64_t)1;
+        }
+
+        const int tile_bits = game->local_cols + 1 - w * PACKED_WORD_BITS;
+        if (tile_bits <= 0) {
+          bits = 0;
+        } else if (tile_bits < PACKED_WORD_BITS) {
+          bits &= ((uint64_t)1 << tile_bits) - 1;
+        }
+        population += __builtin_popcountll(bits);
+      }
+    }
+    return population;
+  }
+
+  // Cells are 0 or 1 bytes, the multiply adds up the 8 bytes of a word in
+  // its top byte
+  const int cols_pad = padded_cols(game);
+  const int cols = game->local_cols;
+  #pragma omp parallel for schedule(static) reduction(+:population)
+  for (int r = 0; r < game->local_rows; r++) {
+    const bool* const cells = &game->current[(r + game->halo) * cols_pad + game->halo];
+    int c = 0;
+    for (; c + 8 <= cols; c += 8) {
+      uint64_t word;
+      memcpy(&word, &cells[c], sizeof(word));
+      population += (word * 0x0101010101010101ull) >> 56;
+    }
+    for (; c < cols; c++) {
+      population += cells[c];
+    }
+  }
+  return population;
+}
+
+unsigned long long count_population(GameInfo* const game)
+{
+  unsigned long long population = local_population(game);
+  MPI_Allreduce(MPI_IN_PLACE, &population, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, game->communicator);
+  return population;
 }
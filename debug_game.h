@@ -2,5 +2,18 @@
 
 #include "initialize_game.h"
 
+// Collect the padded byte tiles of all ranks into a global_rows x
+// global_cols board on recv_rank, through the node leaders for
+// --gather=node if recv_rank is 0
+int gatter_matrix(
+  const bool* restrict const local_matrix,
+        bool* restrict const global_matrix,
+  GameInfo* const game, const int recv_rank);
+
+// Number of live cells in the tile of this rank, and on the board, returned
+// on all ranks
+unsigned long long local_population(GameInfo* const game);
+unsigned long long count_population(GameInfo* const game);
+
 void print_matrix(const bool* const restrict game, const int rows, const int cols);
 void print_global_game(GameInfo* game, const int rank);
@@ -0,0 +1,181 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ensemble_game.h"
+#include "options_game.h"
+#include "run_game.h"
+
+// Read the whole file on rank 0 and broadcast it, NULL if it can't be read
+static char* read_ensemble(const char* const path, const MPI_Comm parent)
+{
+  int rank;
+  MPI_Comm_rank(parent, &rank);
+
+  long length = -1;
+  char* text = NULL;
+
+  if (rank == 0) {
+    FILE* const file = fopen(path, "rb");
+    if (file != NULL) {
+      fseek(file, 0, SEEK_END);
+      length = ftell(file);
+      fseek(file, 0, SEEK_SET);
+
+      text = (char*)malloc(length + 1);
+      if (fread(text, 1, length, file) != (size_t)length) {
+        length = -1;
+      }
+      fclose(file);
+    }
+  }
+
+  MPI_Bcast(&length, 1, MPI_LONG, 0, parent);
+  if (length < 0) {
+    free(text);
+    return NULL;
+  }
+
+  if (rank != 0) {
+    text = (char*)malloc(length + 1);
+  }
+  MPI_Bcast(text, length, MPI_CHAR, 0, parent);
+  text[length] = '\0';
+
+  return text;
+}
+
+// Split text into its board lines in place
+static int split_boards(char* const text, char*** const boards)
+{
+  int count = 0, capacity = 16;
+  *boards = (char**)malloc(capacity * sizeof(char*));
+
+  char* save;
+  for (char* line = strtok_r(text, "\n", &save); line != NULL;
+       line = strtok_r(NULL, "\n", &save)) {
+    line += strspn(line, " \t\r");
+    if (*line == '\0' || *line == '#') {
+      continue;
+    }
+
+    if (count == capacity) {
+      capacity *= 2;
+      *boards = (char**)realloc(*boards, capacity * sizeof(char*));
+    }
+    (*boards)[count++] = line;
+  }
+
+  return count;
+}
+
+// Options of a board, its line appended to the command line so they win
+static int parse_board_options(
+  GameOptions* const options, int argc, char* argv[],
+  const char* const board, const int rank)
+{
+  char* const line = strdup(board);
+  char** const args = (char**)malloc((argc + strlen(line) / 2 + 2) * sizeof(char*));
+
+  int count = 0;
+  for (int i = 0; i < argc; i++) {
+    args[count++] = argv[i];
+  }
+
+  char* save;
+  for (char* arg = strtok_r(line, " \t\r", &save); arg != NULL;
+       arg = strtok_r(NULL, " \t\r", &save)) {
+    args[count++] = arg;
+  }
+  args[count] = NULL;
+
+  const int ierror = parse_options(options, count, args, rank);
+  options->quiet = true;
+
+  free(args);
+  free(line);
+  return ierror;
+}
+
+int run_ensemble(
+  const GameOptions* const options, int argc, char* argv[], const MPI_Comm parent)
+{
+  int rank, size;
+  MPI_Comm_rank(parent, &rank);
+  MPI_Comm_size(parent, &size);
+
+  char* const text = read_ensemble(options->ensemble_path, parent);
+  if (text == NULL) {
+    if (rank == 0) fprintf(stderr, "can't read ensemble %s\n", options->ensemble_path);
+    return 1;
+  }
+
+  char** boards;
+  const int count = split_boards(text, &boards);
+
+  // The last group is smaller if the ranks don't divide evenly
+  const int group_size = options->ensemble_ranks < size ? options->ensemble_ranks : size;
+  const int groups = (size + group_size - 1) / group_size;
+  const int group = rank / group_size;
+
+  MPI_Comm communicator;
+  MPI_Comm_split(parent, group, rank, &communicator);
+  int group_rank;
+  MPI_Comm_rank(communicator, &group_rank);
+
+  // Summed over the groups, only the leader of the group running a board
+  // fills in its entries
+  long long* const results = (long long*)calloc(5 * (size_t)count, sizeof(long long));
+  long long* const generation = results;
+  long long* const population = &results[count];
+  long long* const settled = &results[2 * count];
+  long long* const period = &results[3 * count];
+  long long* const failed = &results[4 * count];
+
+  for (int b = group; b < count; b += groups) {
+    GameOptions board_options;
+    GameResult result;
+
+    if (parse_board_options(&board_options, argc, argv, boards[b], group_rank) ||
+        run_game(&board_options, communicator, &result)) {
+      failed[b] = group_rank == 0;
+      continue;
+    }
+
+    if (group_rank == 0) {
+      generation[b] = result.generation;
+      population[b] = result.population;
+      settled[b] = result.settled;
+      period[b] = result.period;
+    }
+  }
+
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : results, results, 5 * count,
+             MPI_LONG_LONG, MPI_SUM, 0, parent);
+
+  int ierror = 0;
+  if (rank == 0) {
+    printf("ensemble: %d boards, %d groups of %d ranks\n", count, groups, group_size);
+    for (int b = 0; b < count; b++) {
+      if (failed[b]) {
+        printf("board %d: failed [%s]\n", b, boards[b]);
+        ierror = 1;
+      } else if (settled[b] < 0) {
+        printf("board %d: generation %lld, population %lld [%s]\n",
+               b, generation[b], population[b], boards[b]);
+      } else {
+        printf("board %d: generation %lld, population %lld, period %lld since generation %lld [%s]\n",
+               b, generation[b], population[b], period[b], settled[b], boards[b]);
+      }
+    }
+  }
+  MPI_Bcast(&ierror, 1, MPI_INT, 0, parent);
+
+  MPI_Comm_free(&communicator);
+  free(results);
+  free(boards);
+  free(text);
+
+  return ierror;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <mpi.h>
+
+#include "options_game.h"
+
+// Ensembles run many independent boards in one job. The ensemble file has
+// one board per line, given as options that are appended to the command
+// line, e.g. "--rule=highlife --size=64x64 --seed=3". Empty lines and lines
+// starting with '#' are skipped.
+//
+// parent is split into groups of options->ensemble_ranks ranks, and group g
+// runs boards g, g + groups, ... one after the other, so small boards don't
+// pay for a job each and a group can run many of them. Boards are never
+// printed. Once all are done rank 0 prints the final generation and
+// population of every board, in file order.
+int run_ensemble(
+  const GameOptions* const options, int argc, char* argv[], const MPI_Comm parent);
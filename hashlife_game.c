@@ -0,0 +1,622 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "debug_game.h"
+#include "sparse_game.h"
+#include "hashlife_game.h"
+
+#define INITIAL_BUCKETS (1 << 16)
+
+static const char* const STATUS_MESSAGES[] = {
+  "",
+  "the pattern needs a larger --hashlife-memory",
+  "the pattern grows too large",
+  "live cells reach the board edge, which the stencil keeps dead"
+};
+
+// Level 0 nodes are not in the hash table
+static HashNode dead_cell  = {NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, -1, false};
+static HashNode alive_cell = {NULL, NULL, NULL, NULL, NULL, NULL, 1, 0, -1, false};
+
+static inline size_t node_hash(
+  const HashNode* const nw, const HashNode* const ne,
+  const HashNode* const sw, const HashNode* const se)
+{
+  uint64_t h = (uintptr_t)nw * 0x9e3779b97f4a7c15ull;
+  h = (h ^ (uintptr_t)ne) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (uintptr_t)sw) * 0x94d049bb133111ebull;
+  h = (h ^ (uintptr_t)se) * 0x9e3779b97f4a7c15ull;
+  return h ^ (h >> 32);
+}
+
+static inline size_t memory_used(const HashLife* const life)
+{
+  return life->node_count * sizeof(HashNode) + life->bucket_count * sizeof(HashNode*);
+}
+
+static void grow_table(HashLife* const life)
+{
+  const size_t bucket_count = 2 * life->bucket_count;
+  HashNode** const buckets = (HashNode**)calloc(bucket_count, sizeof(HashNode*));
+
+  for (size_t b = 0; b < life->bucket_count; b++) {
+    for (HashNode* node = life->buckets[b]; node != NULL;) {
+      HashNode* const next = node->next;
+      const size_t h = node_hash(node->nw, node->ne, node->sw, node->se) & (bucket_count - 1);
+      node->next = buckets[h];
+      buckets[h] = node;
+      node = next;
+    }
+  }
+
+  free(life->buckets);
+  life->buckets = buckets;
+  life->bucket_count = bucket_count;
+}
+
+// The canonical node with these children
+static HashNode* find_node(
+  HashLife* const life,
+  HashNode* const nw, HashNode* const ne,
+  HashNode* const sw, HashNode* const se)
+{
+  size_t h = node_hash(nw, ne, sw, se) & (life->bucket_count - 1);
+  for (HashNode* node = life->buckets[h]; node != NULL; node = node->next) {
+    if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+      return node;
+    }
+  }
+
+  if (life->node_count >= life->bucket_count) {
+    grow_table(life);
+    h = node_hash(nw, ne, sw, se) & (life->bucket_count - 1);
+  }
+
+  HashNode* const node = (HashNode*)malloc(sizeof(HashNode));
+  node->nw = nw;
+  node->ne = ne;
+  node->sw = sw;
+  node->se = se;
+  node->result = NULL;
+  node->population = nw->population + ne->population + sw->population + se->population;
+  node->level = nw->level + 1;
+  node->result_step = -1;
+  node->marked = false;
+
+  node->next = life->buckets[h];
+  life->buckets[h] = node;
+  life->node_count++;
+
+  return node;
+}
+
+void initialize_hashlife(HashLife* const life, const GameRule* const rule, const size_t memory_cap)
+{
+  life->birth = rule->birth;
+  life->survive = rule->survive;
+
+  // A table of the full initial size alone could exceed small caps
+  life->bucket_count = INITIAL_BUCKETS;
+  while (life->bucket_count > 64 && life->bucket_count * sizeof(HashNode*) > memory_cap / 16) {
+    life->bucket_count /= 2;
+  }
+  life->buckets = (HashNode**)calloc(life->bucket_count, sizeof(HashNode*));
+  life->node_count = 0;
+  life->memory_cap = memory_cap;
+  life->frame_count = 0;
+  life->failed = false;
+
+  life->empty[0] = &dead_cell;
+  for (int level = 1; level <= HASHLIFE_MAX_LEVEL; level++) {
+    HashNode* const e = life->empty[level - 1];
+    life->empty[level] = find_node(life, e, e, e, e);
+  }
+
+  life->root = life->empty[3];
+  life->row = 0;
+  life->col = 0;
+}
+
+// Nodes held by a successor call while it recurses: its node, the nine
+// subnodes, the four nodes made of them and their successors
+typedef struct SuccessorFrame {
+  HashNode* node;
+  HashNode* sub[3][3];
+  HashNode* quadrants[4];
+  HashNode* next[4];
+} SuccessorFrame;
+
+//
+// Garbage collection
+//
+static void mark_node(HashNode* const node, const bool results)
+{
+  if (node->level == 0 || node->marked) {
+    return;
+  }
+
+  node->marked = true;
+  mark_node(node->nw, results);
+  mark_node(node->ne, results);
+  mark_node(node->sw, results);
+  mark_node(node->se, results);
+
+  if (results && node->result != NULL) {
+    mark_node(node->result, results);
+  }
+}
+
+// Frames are filled while the successor runs, the rest is NULL
+static inline void mark_frame_node(HashNode* const node, const bool results)
+{
+  if (node != NULL) {
+    mark_node(node, results);
+  }
+}
+
+static void mark_roots(HashLife* const life, const bool results)
+{
+  mark_node(life->root, results);
+  for (int level = 1; level <= HASHLIFE_MAX_LEVEL; level++) {
+    mark_node(life->empty[level], results);
+  }
+
+  for (int f = 0; f < life->frame_count; f++) {
+    const SuccessorFrame* const frame = life->frames[f];
+    mark_node(frame->node, results);
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) {
+        mark_frame_node(frame->sub[r][c], results);
+      }
+    }
+    for (int q = 0; q < 4; q++) {
+      mark_frame_node(frame->quadrants[q], results);
+      mark_frame_node(frame->next[q], results);
+    }
+  }
+}
+
+// Free the unmarked nodes and clear the marks of the others
+static void sweep(HashLife* const life, const bool keep_results)
+{
+  for (size_t b = 0; b < life->bucket_count; b++) {
+    HashNode** link = &life->buckets[b];
+
+    while (*link != NULL) {
+      HashNode* const node = *link;
+
+      if (node->marked) {
+        node->marked = false;
+        if (!keep_results) {
+          node->result = NULL;
+          node->result_step = -1;
+        }
+        link = &node->next;
+      } else {
+        *link = node->next;
+        free(node);
+        life->node_count--;
+      }
+    }
+  }
+}
+
+// First drop the nodes that are neither part of the universe nor a memoized
+// result of one of its nodes. If that doesn't free half of the cap, drop the
+// memoized results as well.
+static void collect_garbage(HashLife* const life)
+{
+  mark_roots(life, true);
+  sweep(life, true);
+
+  if (memory_used(life) > life->memory_cap / 2) {
+    mark_roots(life, false);
+    sweep(life, false);
+  }
+}
+
+// Collect garbage once the cache is over the cap. If the nodes in use still
+// take more than half of it, collections would free too little to make
+// progress, and the step fails rather than exceeding the cap.
+static inline void limit_memory(HashLife* const life)
+{
+  if (memory_used(life) <= life->memory_cap) {
+    return;
+  }
+
+  collect_garbage(life);
+  if (memory_used(life) > life->memory_cap / 2) {
+    life->failed = true;
+  }
+}
+
+//
+// Evolution
+//
+
+// Center 2x2 cells of a 4x4 node after one generation
+static HashNode* base_successor(HashLife* const life, const HashNode* const node)
+{
+  const HashNode* const quadrants[2][2] = {{node->nw, node->ne}, {node->sw, node->se}};
+  bool cells[4][4];
+
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      const HashNode* const quadrant = quadrants[r / 2][c / 2];
+      const HashNode* const cell_nodes[2][2] = {{quadrant->nw, quadrant->ne}, {quadrant->sw, quadrant->se}};
+      cells[r][c] = cell_nodes[r % 2][c % 2]->population;
+    }
+  }
+
+  HashNode* next[2][2];
+  for (int r = 1; r <= 2; r++) {
+    for (int c = 1; c <= 2; c++) {
+      int count = 0;
+      for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+          count += (dr != 0 || dc != 0) && cells[r + dr][c + dc];
+        }
+      }
+      const bool alive = ((cells[r][c] ? life->survive : life->birth) >> count) & 1;
+      next[r - 1][c - 1] = alive ? &alive_cell : &dead_cell;
+    }
+  }
+
+  return find_node(life, next[0][0], next[0][1], next[1][0], next[1][1]);
+}
+
+// Subnodes of half the size, centered on the node or between two nodes
+static inline HashNode* center(HashLife* const life, const HashNode* const node)
+{
+  return find_node(life, node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+static inline HashNode* horizontal_center(
+  HashLife* const life, const HashNode* const west, const HashNode* const east)
+{
+  return find_node(life, west->ne, east->nw, west->se, east->sw);
+}
+
+static inline HashNode* vertical_center(
+  HashLife* const life, const HashNode* const north, const HashNode* const south)
+{
+  return find_node(life, north->sw, north->se, south->nw, south->ne);
+}
+
+// Center of a level n node advanced by 2^min(step, n - 2) generations.
+// The node is split into nine overlapping subnodes of half its size. With
+// the full step both the subnodes and the four nodes made of them are
+// advanced, otherwise the subnodes are just centered. The cache may be
+// collected on entry, so the nodes still needed live in a registered frame.
+static HashNode* successor(HashLife* const life, HashNode* const node, const int step)
+{
+  const int level = node->level;
+  const int effective_step = step < level - 2 ? step : level - 2;
+
+  limit_memory(life);
+  if (life->failed || node->population == 0) {
+    return life->empty[level - 1];
+  }
+  if (node->result != NULL && node->result_step == effective_step) {
+    return node->result;
+  }
+
+  HashNode* result;
+  if (level == 2) {
+    result = base_successor(life, node);
+  } else {
+    SuccessorFrame frame = {node, {{NULL}}, {NULL}, {NULL}};
+    life->frames[life->frame_count++] = &frame;
+
+    HashNode* (*const sub)[3] = frame.sub;
+    sub[0][0] = node->nw;
+    sub[0][1] = horizontal_center(life, node->nw, node->ne);
+    sub[0][2] = node->ne;
+    sub[1][0] = vertical_center(life, node->nw, node->sw);
+    sub[1][1] = center(life, node);
+    sub[1][2] = vertical_center(life, node->ne, node->se);
+    sub[2][0] = node->sw;
+    sub[2][1] = horizontal_center(life, node->sw, node->se);
+    sub[2][2] = node->se;
+
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) {
+        sub[r][c] = step >= level - 2 ? successor(life, sub[r][c], step)
+                                      : center(life, sub[r][c]);
+      }
+    }
+
+    frame.quadrants[0] = find_node(life, sub[0][0], sub[0][1], sub[1][0], sub[1][1]);
+    frame.quadrants[1] = find_node(life, sub[0][1], sub[0][2], sub[1][1], sub[1][2]);
+    frame.quadrants[2] = find_node(life, sub[1][0], sub[1][1], sub[2][0], sub[2][1]);
+    frame.quadrants[3] = find_node(life, sub[1][1], sub[1][2], sub[2][1], sub[2][2]);
+
+    for (int q = 0; q < 4; q++) {
+      frame.next[q] = successor(life, frame.quadrants[q], step);
+    }
+
+    result = find_node(life, frame.next[0], frame.next[1], frame.next[2], frame.next[3]);
+    life->frame_count--;
+  }
+
+  if (life->failed) {
+    return result;
+  }
+
+  node->result = result;
+  node->result_step = effective_step;
+  return result;
+}
+
+// Surround the universe with empty space, keeping it centered. False if it
+// is already of the largest level.
+static bool expand(HashLife* const life)
+{
+  HashNode* const root = life->root;
+  if (root->level >= HASHLIFE_MAX_LEVEL) {
+    return false;
+  }
+
+  HashNode* const e = life->empty[root->level - 1];
+
+  life->row -= (int64_t)1 << (root->level - 1);
+  life->col -= (int64_t)1 << (root->level - 1);
+  life->root = find_node(life,
+                         find_node(life, e, e, e, root->nw),
+                         find_node(life, e, e, root->ne, e),
+                         find_node(life, e, root->sw, e, e),
+                         find_node(life, root->se, e, e, e));
+  return true;
+}
+
+// All cells in the central quarter of the width, the rest is margin for the
+// pattern to grow into while the universe shrinks to its center
+static inline bool centered(const HashNode* const root)
+{
+  return root->population == root->nw->se->se->population +
+                             root->ne->sw->sw->population +
+                             root->sw->ne->ne->population +
+                             root->se->nw->nw->population;
+}
+
+HashLifeStatus advance_hashlife(HashLife* const life, const uint64_t generations)
+{
+  // One power of two step per set bit
+  for (int step = 0; step < 64 && (generations >> step) != 0; step++) {
+    if (((generations >> step) & 1) == 0) {
+      continue;
+    }
+
+    while (life->root->level < step + 3 || !centered(life->root)) {
+      if (!expand(life)) {
+        return HASHLIFE_TOO_LARGE;
+      }
+    }
+
+    const int level = life->root->level;
+    life->root = successor(life, life->root, step);
+    if (life->failed) {
+      return HASHLIFE_OUT_OF_MEMORY;
+    }
+    life->row += (int64_t)1 << (level - 2);
+    life->col += (int64_t)1 << (level - 2);
+  }
+
+  return HASHLIFE_OK;
+}
+
+//
+// Dead board edges
+//
+enum Side { NORTH, SOUTH, WEST, EAST };
+
+static inline int64_t min_int64(const int64_t a, const int64_t b)
+{
+  return a < b ? a : b;
+}
+
+// Distance from a side of a nonempty node to its nearest live cell
+static int64_t live_distance(const HashNode* const node, const enum Side side)
+{
+  if (node->level == 0) {
+    return 0;
+  }
+
+  // Children along the side, then the ones of the other half
+  const HashNode* children[4];
+  switch (side) {
+    case NORTH:
+      children[0] = node->nw; children[1] = node->ne; children[2] = node->sw; children[3] = node->se;
+      break;
+    case SOUTH:
+      children[0] = node->sw; children[1] = node->se; children[2] = node->nw; children[3] = node->ne;
+      break;
+    case WEST:
+      children[0] = node->nw; children[1] = node->sw; children[2] = node->ne; children[3] = node->se;
+      break;
+    default:
+      children[0] = node->ne; children[1] = node->se; children[2] = node->nw; children[3] = node->sw;
+      break;
+  }
+
+  const int64_t half = (int64_t)1 << (node->level - 1);
+  for (int pair = 0; pair < 2; pair++) {
+    int64_t distance = INT64_MAX;
+    for (int k = 2 * pair; k < 2 * pair + 2; k++) {
+      if (children[k]->population > 0) {
+        distance = min_int64(distance, live_distance(children[k], side));
+      }
+    }
+    if (distance != INT64_MAX) {
+      return pair * half + distance;
+    }
+  }
+
+  return INT64_MAX;
+}
+
+// Distance of the live cells to the outside of the board, negative once
+// some are outside
+static int64_t board_margin(const HashLife* const life, const int rows, const int cols)
+{
+  const HashNode* const root = life->root;
+  if (root->population == 0) {
+    return INT64_MAX;
+  }
+
+  const int64_t last = ((int64_t)1 << root->level) - 1;
+  const int64_t top = life->row + live_distance(root, NORTH);
+  const int64_t bottom = life->row + last - live_distance(root, SOUTH);
+  const int64_t left = life->col + live_distance(root, WEST);
+  const int64_t right = life->col + last - live_distance(root, EAST);
+
+  return min_int64(min_int64(top, rows - 1 - bottom), min_int64(left, cols - 1 - right));
+}
+
+HashLifeStatus advance_board(HashLife* const life, const uint64_t generations,
+                             const int rows, const int cols)
+{
+  uint64_t remaining = generations;
+  while (remaining > 0) {
+    const int64_t margin = board_margin(life, rows, cols);
+    if (margin < 0) {
+      return HASHLIFE_EDGE;
+    }
+
+    // A cell outside is reached after one generation more than the distance
+    uint64_t step = 1;
+    while (2 * step <= remaining && (int64_t)(2 * step) <= margin) {
+      step *= 2;
+    }
+
+    const HashLifeStatus status = advance_hashlife(life, step);
+    if (status != HASHLIFE_OK) {
+      return status;
+    }
+    remaining -= step;
+  }
+
+  return board_margin(life, rows, cols) < 0 ? HASHLIFE_EDGE : HASHLIFE_OK;
+}
+
+//
+// Conversion from and to boards
+//
+static HashNode* build_node(
+  HashLife* const life, const bool* restrict const board,
+  const int rows, const int cols,
+  const int level, const int64_t row, const int64_t col)
+{
+  if (row >= rows || col >= cols) {
+    return life->empty[level];
+  }
+  if (level == 0) {
+    return board[row * cols + col] ? &alive_cell : &dead_cell;
+  }
+
+  const int64_t half = (int64_t)1 << (level - 1);
+  return find_node(life,
+                   build_node(life, board, rows, cols, level - 1, row, col),
+                   build_node(life, board, rows, cols, level - 1, row, col + half),
+                   build_node(life, board, rows, cols, level - 1, row + half, col),
+                   build_node(life, board, rows, cols, level - 1, row + half, col + half));
+}
+
+void load_hashlife(HashLife* const life, const bool* restrict const board,
+                   const int rows, const int cols)
+{
+  int level = 3;
+  while (((int64_t)1 << level) < rows || ((int64_t)1 << level) < cols) {
+    level++;
+  }
+
+  life->root = build_node(life, board, rows, cols, level, 0, 0);
+  life->row = 0;
+  life->col = 0;
+}
+
+static void export_node(
+  const HashNode* const node, bool* restrict const board,
+  const int rows, const int cols, const int64_t row, const int64_t col)
+{
+  const int64_t width = (int64_t)1 << node->level;
+
+  if (node->population == 0 ||
+      row >= rows || col >= cols || row + width <= 0 || col + width <= 0) {
+    return;
+  }
+  if (node->level == 0) {
+    board[row * cols + col] = 1;
+    return;
+  }
+
+  const int64_t half = width / 2;
+  export_node(node->nw, board, rows, cols, row, col);
+  export_node(node->ne, board, rows, cols, row, col + half);
+  export_node(node->sw, board, rows, cols, row + half, col);
+  export_node(node->se, board, rows, cols, row + half, col + half);
+}
+
+void export_hashlife(const HashLife* const life, bool* restrict const board,
+                     const int rows, const int cols)
+{
+  memset(board, 0, (size_t)rows * cols * sizeof(bool));
+  export_node(life->root, board, rows, cols, life->row, life->col);
+}
+
+void destroy_hashlife(HashLife* const life)
+{
+  for (size_t b = 0; b < life->bucket_count; b++) {
+    for (HashNode* node = life->buckets[b]; node != NULL;) {
+      HashNode* const next = node->next;
+      free(node);
+      node = next;
+    }
+  }
+
+  free(life->buckets);
+  life->buckets = NULL;
+  life->node_count = 0;
+}
+
+int jump_game(GameInfo* const game, const uint64_t generations, const size_t memory_cap)
+{
+  bool* const tile = acquire_tile(game);
+
+  bool* const board = game->rank == 0 ? game->gather.board : NULL;
+
+  int ierror = gatter_matrix(tile, board, game, 0);
+
+  // The board is left as it was if the jump fails
+  int status = HASHLIFE_OK;
+  if (game->rank == 0) {
+    HashLife life;
+    initialize_hashlife(&life, &game->rule, memory_cap);
+    load_hashlife(&life, board, game->global_rows, game->global_cols);
+    status = advance_board(&life, generations, game->global_rows, game->global_cols);
+    if (status == HASHLIFE_OK) {
+      export_hashlife(&life, board, game->global_rows, game->global_cols);
+    } else {
+      fprintf(stderr, "HashLife jump failed, %s\n", STATUS_MESSAGES[status]);
+    }
+    destroy_hashlife(&life);
+  }
+  MPI_Bcast(&status, 1, MPI_INT, 0, game->communicator);
+
+  ierror |= (status != HASHLIFE_OK) | scatter_matrix(board, tile, game, 0);
+  release_tile(game, tile, true);
+
+  // Every cell may have changed, the halos are stale
+  game->halo_age = game->halo;
+  if (game->sparse) {
+    reset_sparse_game(game);
+  }
+
+  return ierror;
+}
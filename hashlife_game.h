@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "rule_game.h"
+
+// HashLife keeps the board as a quadtree in which equal subtrees are the same
+// node (hash consing), and memoizes for every node its center advanced by a
+// power of two generations. Repetitive patterns then advance exponentially
+// fast. Level 0 nodes are single cells, a level n node is 2^n cells wide.
+typedef struct HashNode {
+  struct HashNode* nw;
+  struct HashNode* ne;
+  struct HashNode* sw;
+  struct HashNode* se;
+
+  // center advanced by 2^result_step generations, or NULL
+  struct HashNode* result;
+
+  // next node in the same hash bucket
+  struct HashNode* next;
+
+  uint64_t population;
+  int8_t level;
+  int8_t result_step;
+  bool marked;
+} HashNode;
+
+#define HASHLIFE_MAX_LEVEL 62
+
+struct SuccessorFrame;
+
+typedef struct HashLife {
+  // canonical nodes, chained per bucket
+  HashNode** buckets;
+  size_t bucket_count;
+  size_t node_count;
+
+  // the cache is garbage collected once it uses more than memory_cap bytes,
+  // also in the middle of a step
+  size_t memory_cap;
+
+  // nodes held by the successor calls in progress, which are roots of the
+  // garbage collection next to the universe
+  struct SuccessorFrame* frames[HASHLIFE_MAX_LEVEL + 1];
+  int frame_count;
+
+  // set when the nodes in use don't fit the cap or the universe outgrows
+  // the largest level, the step is abandoned
+  bool failed;
+
+  // empty node of every level
+  HashNode* empty[HASHLIFE_MAX_LEVEL + 1];
+
+  // the universe, with its top left cell at board position (row, col)
+  HashNode* root;
+  int64_t row;
+  int64_t col;
+
+  // life-like rule, see rule_game.h
+  uint16_t birth;
+  uint16_t survive;
+} HashLife;
+
+void initialize_hashlife(HashLife* const life, const GameRule* const rule, const size_t memory_cap);
+
+// Build the universe from a rows x cols board, with its top left cell at
+// the origin
+void load_hashlife(HashLife* const life, const bool* restrict const board,
+                   const int rows, const int cols);
+
+// Outcome of advancing the universe, it is undefined after a failure
+typedef enum HashLifeStatus {
+  HASHLIFE_OK,
+  HASHLIFE_OUT_OF_MEMORY,  // the nodes in use don't fit into the memory cap
+  HASHLIFE_TOO_LARGE,      // the universe would outgrow HASHLIFE_MAX_LEVEL
+  HASHLIFE_EDGE            // live cells were born outside of the board
+} HashLifeStatus;
+
+// HashLife runs on the infinite plane, unlike the stencil whose board edges
+// are dead. Patterns that reach the edges of the board evolve differently.
+HashLifeStatus advance_hashlife(HashLife* const life, const uint64_t generations);
+
+// Advance the universe as the stencil would advance the rows x cols board
+// at the origin. Cells outside of it stay dead as long as no live cell is
+// closer to the edge than the number of generations, so the universe moves
+// on in power of two steps within that distance, and single generations
+// next to the edge. Fails with HASHLIFE_EDGE once a cell is born outside.
+HashLifeStatus advance_board(HashLife* const life, const uint64_t generations,
+                             const int rows, const int cols);
+
+// Write the cells of the rows x cols board at the origin, cells outside of
+// it are dropped
+void export_hashlife(const HashLife* const life, bool* restrict const board,
+                     const int rows, const int cols);
+
+void destroy_hashlife(HashLife* const life);
+
+// Gather the board on rank 0, advance it there with HashLife and scatter it
+// back into the tiles. Rank 0 reports why a jump failed, the board is then
+// left as it was.
+int jump_game(GameInfo* const game, const uint64_t generations, const size_t memory_cap);
@@ -2,19 +2,31 @@
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 #include "initialize_game.h"
+#include "packed_game.h"
+#include "sparse_game.h"
+#include "synchronize_game.h"
+
+static const int SCATTER_TAG = 20;
 
 static inline int rank_by_shift(
   const MPI_Comm communicator,
   const int* restrict const self_coords, const int* restrict const dims,
-  const int dim0, const int dim1)
+  const int dim0, const int dim1, const bool periodic)
 {
 
-  const int coords[2] = { self_coords[0] + dim0, self_coords[1] + dim1 };
+  int coords[2] = { self_coords[0] + dim0, self_coords[1] + dim1 };
   int rank = MPI_PROC_NULL;
 
+  // Wrap around the edges of the board, corners included
+  if (periodic) {
+    coords[0] = (coords[0] + dims[0]) % dims[0];
+    coords[1] = (coords[1] + dims[1]) % dims[1];
+  }
+
   if (coords[0] >= 0 && coords[0] < dims[0] &&
       coords[1] >= 0 && coords[1] < dims[1]) {
         MPI_Cart_rank(communicator, coords, &rank);
@@ -23,231 +35,619 @@ static inline int rank_by_shift(
   return rank;
 }
 
+static inline int ceil_div(const int a, const int b) {
+  return (a + b - 1) / b;
+}
+
+// Process grid for the board. Every rank exchanges the perimeter of its
+// tile each generation, so among the factorizations of size whose tiles
+// hold at least halo rows and cols take the one with the smallest tile
+// perimeter, and the squarer grid on ties. A 16384x1024 board on 16 ranks
+// gets 16x1 tiles of 1024x1024 rather than 4x4 tiles of 4096x256. Returns
+// false if no grid fits the board.
+static bool choose_dims(
+  const int size, const int rows, const int cols, const int halo, int* restrict const dims)
+{
+  long best = -1;
+  for (int pr = 1; pr <= size; pr++) {
+    const int pc = size / pr;
+    if (pr * pc != size || rows / pr < halo || cols / pc < halo) {
+      continue;
+    }
+
+    const long perimeter = (long)ceil_div(rows, pr) + ceil_div(cols, pc);
+    if (best < 0 || perimeter < best ||
+        (perimeter == best && abs(pr - pc) < abs(dims[0] - dims[1]))) {
+      best = perimeter;
+      dims[0] = pr;
+      dims[1] = pc;
+    }
+  }
+
+  return best >= 0;
+}
+
+// Position of this rank of parent in the row major process grid, so that
+// the ranks of a node get a compact block of the grid and most halos are
+// exchanged within the node. Nodes are told apart by their shared memory
+// communicators. If all nodes have the same number of ranks the grid is cut
+// into equal node blocks, with the block shape of the smallest perimeter,
+// otherwise the ranks fill the grid row by row, node after node.
+static int placement_key(
+  const MPI_Comm parent, const int* restrict const dims, const int rows, const int cols)
+{
+  int rank;
+  MPI_Comm_rank(parent, &rank);
+
+  MPI_Comm node;
+  MPI_Comm_split_type(parent, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+  int node_rank, node_size;
+  MPI_Comm_rank(node, &node_rank);
+  MPI_Comm_size(node, &node_size);
+
+  // Node index and the ranks on the nodes before, known to their leaders
+  int node_info[3] = {0, 0, 1};
+  MPI_Comm leaders;
+  MPI_Comm_split(parent, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &leaders);
+  if (leaders != MPI_COMM_NULL) {
+    MPI_Comm_rank(leaders, &node_info[0]);
+    MPI_Comm_size(leaders, &node_info[2]);
+    MPI_Exscan(&node_size, &node_info[1], 1, MPI_INT, MPI_SUM, leaders);
+    if (node_info[0] == 0) {
+      node_info[1] = 0;
+    }
+    MPI_Comm_free(&leaders);
+  }
+  MPI_Bcast(node_info, 3, MPI_INT, 0, node);
+  MPI_Comm_free(&node);
+
+  const int node_index = node_info[0], node_offset = node_info[1];
+
+  int extremes[2] = {node_size, -node_size};
+  MPI_Allreduce(MPI_IN_PLACE, extremes, 2, MPI_INT, MPI_MAX, parent);
+  if (extremes[0] != -extremes[1]) {
+    return node_offset + node_rank;
+  }
+
+  // Node blocks of nr x nc tiles, their perimeter in cells
+  int block[2] = {0, 0};
+  double best = -1.0;
+  for (int nr = 1; nr <= node_size; nr++) {
+    const int nc = node_size / nr;
+    if (nr * nc != node_size || dims[0] % nr != 0 || dims[1] % nc != 0) {
+      continue;
+    }
+
+    const double perimeter = (double)nr * rows / dims[0] + (double)nc * cols / dims[1];
+    if (best < 0.0 || perimeter < best) {
+      best = perimeter;
+      block[0] = nr;
+      block[1] = nc;
+    }
+  }
+  if (best < 0.0) {
+    return node_offset + node_rank;
+  }
+
+  const int blocks_per_row = dims[1] / block[1];
+  const int row = (node_index / blocks_per_row) * block[0] + node_rank / block[1];
+  const int col = (node_index % blocks_per_row) * block[1] + node_rank % block[1];
+  return row * dims[1] + col;
+}
+
 // From http://stackoverflow.com/questions/10788180/sending-columns-of-a-matrix-using-mpi-scatter
 // I'm getting that MPI_Type_create_resized is not needed for MPI_send MPI_recv
 // calls.
-static inline void set_row_type(
-  struct TopologyDirection* const send_direction, const int send_row,
-  struct TopologyDirection* const recv_direction, const int recv_row,
-  const int col_offset, const int local_rows, const int local_cols)
+static inline void set_direction_type(
+  struct TopologyDirection* const direction,
+  const int block_rows, const int block_cols,
+  const int send_row, const int send_col,
+  const int recv_row, const int recv_col,
+  const GameInfo* const game)
 {
-  // Create subarray send data type
-  int array_size[]        = {local_rows + 2, local_cols + 2};
-  int array_subsize[]     = {1,              local_cols};
-  int array_offset_send[] = {send_row,       col_offset};
+  direction->block_size[0] = block_rows;
+  direction->block_size[1] = block_cols;
+  direction->send_offset[0] = send_row;
+  direction->send_offset[1] = send_col;
+  direction->recv_offset[0] = recv_row;
+  direction->recv_offset[1] = recv_col;
 
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_send,
-                           MPI_ORDER_C, MPI_C_BOOL, &send_direction->send_type);
-  MPI_Type_commit(&send_direction->send_type);
+  // Create subarray send data type
+  int array_size[] = {game->local_rows + 2 * game->halo, game->local_cols + 2 * game->halo};
+  MPI_Type_create_subarray(2, array_size, direction->block_size, direction->send_offset,
+                           MPI_ORDER_C, MPI_C_BOOL, &direction->send_type);
+  MPI_Type_commit(&direction->send_type);
 
   // Create subarray recv data type
-  int array_offset_recv[] = {recv_row,       col_offset};
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_recv,
-                           MPI_ORDER_C, MPI_C_BOOL, &recv_direction->recv_type);
-  MPI_Type_commit(&recv_direction->recv_type);
+  MPI_Type_create_subarray(2, array_size, direction->block_size, direction->recv_offset,
+                           MPI_ORDER_C, MPI_C_BOOL, &direction->recv_type);
+  MPI_Type_commit(&direction->recv_type);
 }
 
-static inline void set_corner_type(
-  struct TopologyDirection* const send_direction, const int send_row, const int send_col_offset,
-  struct TopologyDirection* const recv_direction, const int recv_row, const int recv_col_offset,
-  const int local_rows, const int local_cols)
+// Allocate a zeroed tile of rows x row_bytes. Unlike calloc the pages are
+// first touched by the threads that update the same rows later on, which
+// places them in the NUMA domain of those threads.
+static inline void* allocate_tile(const int rows, const size_t row_bytes)
 {
-  // Create subarray send data type
-  int array_size[]        = {local_rows + 2, local_cols + 2};
-  int array_subsize[]     = {1,              1};
-  int array_offset_send[] = {send_row,       send_col_offset};
+  char* const tile = (char*)malloc(rows * row_bytes);
 
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_send,
-                           MPI_ORDER_C, MPI_C_BOOL, &send_direction->send_type);
-  MPI_Type_commit(&send_direction->send_type);
+  #pragma omp parallel for schedule(static)
+  for (int r = 0; r < rows; r++) {
+    memset(&tile[r * row_bytes], 0, row_bytes);
+  }
 
-  // Create subarray recv data type
-  int array_offset_recv[] = {recv_row,       recv_col_offset};
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_recv,
-                           MPI_ORDER_C, MPI_C_BOOL, &recv_direction->recv_type);
-  MPI_Type_commit(&recv_direction->recv_type);
+  return tile;
 }
 
-static inline void set_col_type(
-  struct TopologyDirection* const send_direction, const int send_col,
-  struct TopologyDirection* const recv_direction, const int recv_col,
-  const int row_offset, const int local_rows, const int local_cols)
+// Create the halo datatypes and the zeroed byte game data buffers for the
+// tile size in game
+static void create_tile(GameInfo* const game)
 {
-  // Create subarray send data type
-  int array_size[]        = {local_rows + 2, local_cols + 2};
-  int array_subsize[]     = {local_cols,     1};
-  int array_offset_send[] = {row_offset,     send_col};
+  // Create stride types. Each direction sends the halo deep block of the tile
+  // facing that neighbour and receives into the halo on the same side.
+  const int halo = game->halo;
+  const int last_row = game->local_rows;
+  const int last_col = game->local_cols;
+
+  // north and south
+  set_direction_type(&game->topology.north, halo, last_col,
+                     halo, halo, 0, halo, game);
+  set_direction_type(&game->topology.south, halo, last_col,
+                     last_row, halo, last_row + halo, halo, game);
+
+  // north west and south east
+  set_direction_type(&game->topology.north_west, halo, halo,
+                     halo, halo, 0, 0, game);
+  set_direction_type(&game->topology.south_east, halo, halo,
+                     last_row, last_col, last_row + halo, last_col + halo, game);
+
+  // north east and south west
+  set_direction_type(&game->topology.north_east, halo, halo,
+                     halo, last_col, 0, last_col + halo, game);
+  set_direction_type(&game->topology.south_west, halo, halo,
+                     last_row, halo, last_row + halo, 0, game);
+
+  // east and west
+  set_direction_type(&game->topology.east, last_row, halo,
+                     halo, last_col, halo, last_col + halo, game);
+  set_direction_type(&game->topology.west, last_row, halo,
+                     halo, halo, halo, 0, game);
+
+  // The tile inside the padded tile, for whole board transfers
+  int padded_size[] = {game->local_rows + 2 * halo, padded_cols(game)};
+  int local_size[]  = {game->local_rows, game->local_cols};
+  int local_offset[] = {halo, halo};
+  MPI_Type_create_subarray(2, padded_size, local_size, local_offset,
+                           MPI_ORDER_C, MPI_C_BOOL, &game->gather.tile_type);
+  MPI_Type_commit(&game->gather.tile_type);
+  game->gather.board_types = NULL;
+  game->gather.node_types = NULL;
+  game->gather.node_buffer = NULL;
+
+  // Allocate game data buffers
+  if (game->storage == GAME_STORAGE_BYTE && game->exchange == GAME_EXCHANGE_SHARED) {
+    allocate_shared_tiles(game);
+  } else {
+    game->current = (bool*)allocate_tile(game->local_rows + 2 * halo, padded_cols(game) * sizeof(bool));
+    game->previouse = (bool*)allocate_tile(game->local_rows + 2 * halo, padded_cols(game) * sizeof(bool));
+  }
 
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_send,
-                           MPI_ORDER_C, MPI_C_BOOL, &send_direction->send_type);
-  MPI_Type_commit(&send_direction->send_type);
+  game->decay = NULL;
+  if (game->storage == GAME_STORAGE_BYTE && game->rule.states > 2) {
+    game->decay = (uint8_t*)allocate_tile(game->local_rows + 2 * halo, padded_cols(game) * sizeof(uint8_t));
+  }
 
-  // Create subarray recv data type
-  int array_offset_recv[] = {row_offset,     recv_col};
-  MPI_Type_create_subarray(2, array_size, array_subsize, array_offset_recv,
-                           MPI_ORDER_C, MPI_C_BOOL, &recv_direction->recv_type);
-  MPI_Type_commit(&recv_direction->recv_type);
+  game->halo_buffer = NULL;
+  if (game->storage == GAME_STORAGE_BYTE && game->exchange == GAME_EXCHANGE_AGGREGATED) {
+    game->halo_buffer = (bool*)calloc(4 * halo * game->local_rows, sizeof(bool));
+  }
+
+  create_exchange(game);
+}
+
+// Move to the bit packed layout, the byte buffers are only needed for
+// distributing the initial data.
+static void convert_tile(GameInfo* const game)
+{
+  game->packed_cols = packed_words_per_row(game->local_cols);
+  game->packed_current = NULL;
+  game->packed_previouse = NULL;
+  game->packed_halo = NULL;
+
+  if (game->storage == GAME_STORAGE_PACKED) {
+    game->packed_current = (uint64_t*)allocate_tile(game->local_rows + 2, game->packed_cols * sizeof(uint64_t));
+    game->packed_previouse = (uint64_t*)allocate_tile(game->local_rows + 2, game->packed_cols * sizeof(uint64_t));
+    game->packed_halo = (uint64_t*)calloc(4 * packed_column_words(game->local_rows),
+                                          sizeof(uint64_t));
+
+    pack_tile(game->current, game->packed_current,
+              game->local_rows, game->local_cols);
+
+    free(game->current);
+    free(game->previouse);
+    game->current = NULL;
+    game->previouse = NULL;
+  }
+}
+
+// Subarray type of the tile of every rank in the global board
+static void create_board_types(GameInfo* const game)
+{
+  int size;
+  MPI_Comm_size(game->communicator, &size);
+  game->gather.board_types = (MPI_Datatype*)malloc(size * sizeof(MPI_Datatype));
+
+  int global_size[] = {game->global_rows, game->global_cols};
+  for (int other = 0; other < size; other++) {
+    int tile_offset[2], tile_size[2];
+    rank_tile(game, other, tile_offset, tile_size);
+    MPI_Type_create_subarray(2, global_size, tile_size, tile_offset,
+                             MPI_ORDER_C, MPI_C_BOOL, &game->gather.board_types[other]);
+    MPI_Type_commit(&game->gather.board_types[other]);
+  }
+}
+
+// Rank 0 receives node k with a struct of the board types of its ranks, and
+// the leaders collect the tiles of their node in one buffer
+static void create_node_types(GameInfo* const game)
+{
+  struct GatherCache* const gather = &game->gather;
+
+  if (game->rank == 0) {
+    gather->node_types = (MPI_Datatype*)malloc(gather->nodes * sizeof(MPI_Datatype));
+
+    for (int k = 0; k < gather->nodes; k++) {
+      const int members = gather->node_start[k + 1] - gather->node_start[k];
+      int* const lengths = (int*)malloc(members * sizeof(int));
+      MPI_Aint* const displacements = (MPI_Aint*)malloc(members * sizeof(MPI_Aint));
+      MPI_Datatype* const member_types = (MPI_Datatype*)malloc(members * sizeof(MPI_Datatype));
+      for (int i = 0; i < members; i++) {
+        lengths[i] = 1;
+        displacements[i] = 0;
+        member_types[i] = gather->board_types[gather->node_members[gather->node_start[k] + i]];
+      }
+
+      MPI_Type_create_struct(members, lengths, displacements, member_types,
+                             &gather->node_types[k]);
+      MPI_Type_commit(&gather->node_types[k]);
+      free(member_types);
+      free(displacements);
+      free(lengths);
+    }
+  }
+
+  int node_rank, node_size;
+  MPI_Comm_rank(gather->node, &node_rank);
+  MPI_Comm_size(gather->node, &node_size);
+  if (node_rank == 0) {
+    size_t cells = 0;
+    for (int i = 0; i < node_size; i++) {
+      int tile_offset[2], tile_size[2];
+      rank_tile(game, gather->node_members[i], tile_offset, tile_size);
+      cells += (size_t)tile_size[0] * tile_size[1];
+    }
+    gather->node_buffer = (bool*)malloc(cells * sizeof(bool));
+  }
+}
+
+// The whole board transfers of rank 0 follow the tiles, so they are set up
+// with them rather than on the first print or jump. The initial scatter
+// from another rank creates its types there.
+static void create_board_transfers(GameInfo* const game)
+{
+  struct GatherCache* const gather = &game->gather;
+  if (!gather->whole_boards) {
+    return;
+  }
+
+  if (game->rank == 0) {
+    create_board_types(game);
+    if (gather->board == NULL) {
+      gather->board = (bool*)malloc((size_t)game->global_rows * game->global_cols * sizeof(bool));
+    }
+  }
+  if (gather->by_node) {
+    create_node_types(game);
+  }
 }
 
 // Inspired from:
 // http://stackoverflow.com/questions/7549316/mpi-partition-matrix-into-blocks
-static inline int scatter_matrix(
-  const bool* restrict const global_matrix, const int global_rows, const int global_cols,
-        bool* restrict const local_matrix , const int local_rows , const int local_cols ,
-  const int* restrict const dims, const int sender_rank, const MPI_Comm communicator)
+// Tiles may differ in size, which a single Scatterv send type can't express,
+// so the sender posts one send with a subarray type per rank instead.
+int scatter_matrix(
+  const bool* restrict const global_matrix,
+        bool* restrict const local_matrix,
+  GameInfo* const game, const int sender_rank)
 {
-  // Define data type that will have appropiate block and stride length for
-  // each sub matrix.
-  MPI_Datatype send_blocktype;
-  MPI_Datatype send_blocktype_vec;
-  MPI_Type_vector(local_rows, local_cols, global_cols, MPI_C_BOOL, &send_blocktype_vec);
-  MPI_Type_create_resized(send_blocktype_vec, 0, sizeof(bool), &send_blocktype);
-  MPI_Type_commit(&send_blocktype);
-
-  MPI_Datatype recv_blocktype;
-  MPI_Datatype recv_blocktype_vec;
-  MPI_Type_vector(local_rows, local_cols, local_cols + 2, MPI_C_BOOL, &recv_blocktype_vec);
-  MPI_Type_create_resized(recv_blocktype_vec, 0, sizeof(bool), &recv_blocktype);
-  MPI_Type_commit(&recv_blocktype);
-
-  // Create displacement and count matrix for scatterv
-  const int size = dims[0] * dims[1];
-  int* restrict const disp = malloc(size * sizeof(int));
-  int* restrict const count = malloc(size * sizeof(int));
-
-  for (int rank = 0; rank < size; rank++) {
-    int coords[2] = {0, 0};
-    MPI_Cart_coords(communicator, rank, 2, coords);
-
-    count[rank] = 1;
-    disp[rank] = coords[0] * global_cols * local_rows + coords[1] * local_cols;
-  }
-
-  // Scatter data
-  int ierror = MPI_Scatterv(global_matrix, count, disp, send_blocktype,
-                            &local_matrix[(local_cols + 2) + 1], 1, recv_blocktype,
-                            sender_rank, communicator);
-
-  // Free buffers and types
-  free(disp);
-  free(count);
-  MPI_Type_free(&send_blocktype_vec);
-  MPI_Type_free(&send_blocktype);
-  MPI_Type_free(&recv_blocktype_vec);
-  MPI_Type_free(&recv_blocktype);
+  int rank, size;
+  MPI_Comm_rank(game->communicator, &rank);
+  MPI_Comm_size(game->communicator, &size);
+
+  MPI_Request recv_request;
+  int ierror = MPI_Irecv(local_matrix, 1, game->gather.tile_type, sender_rank, SCATTER_TAG,
+                         game->communicator, &recv_request);
+
+  // Send each rank its block of the global matrix
+  if (rank == sender_rank) {
+    if (game->gather.board_types == NULL) {
+      create_board_types(game);
+    }
+    const MPI_Datatype* const send_types = game->gather.board_types;
+    MPI_Request* restrict const send_request = game->gather.requests;
+
+    for (int dest = 0; dest < size; dest++) {
+      MPI_Isend(global_matrix, 1, send_types[dest], dest, SCATTER_TAG,
+                game->communicator, &send_request[dest]);
+    }
+
+    MPI_Waitall(size, send_request, MPI_STATUSES_IGNORE);
+  }
+
+  MPI_Wait(&recv_request, MPI_STATUS_IGNORE);
 
   // Report errors
   return ierror;
 }
 
-int initialize_game(
-  GameInfo* const game,
-  const int size, const int rank,
-  int rows, int cols, const bool* const restrict init)
+// Request buffer for one message per rank and one more, which the node
+// leader gather needs on rank 0, and for the node leader gather
+// the communicator of the ranks on this node and the members of the nodes
+static void create_gather(GameInfo* const game, const bool by_node, const bool whole_boards)
 {
-  // Share cols and rows, these where loaded in rank 0
-  MPI_Bcast(&cols, 1, MPI_INT, 0, MPI_COMM_WORLD);
-  MPI_Bcast(&rows, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  struct GatherCache* const gather = &game->gather;
+  int size;
+  MPI_Comm_size(game->communicator, &size);
+  gather->requests = (MPI_Request*)malloc((size + 1) * sizeof(MPI_Request));
+  gather->board = NULL;
+  gather->whole_boards = whole_boards;
+
+  gather->by_node = by_node;
+  gather->node = MPI_COMM_NULL;
+  gather->nodes = 0;
+  gather->node_start = NULL;
+  gather->node_members = NULL;
+  if (!by_node) {
+    return;
+  }
+
+  MPI_Comm_split_type(game->communicator, MPI_COMM_TYPE_SHARED, game->rank,
+                      MPI_INFO_NULL, &gather->node);
+  int node_rank, node_size;
+  MPI_Comm_rank(gather->node, &node_rank);
+  MPI_Comm_size(gather->node, &node_size);
+
+  // Leaders learn the ranks of their node, rank 0 leads the first node
+  int* const members = node_rank == 0 ? (int*)malloc(node_size * sizeof(int)) : NULL;
+  MPI_Gather(&game->rank, 1, MPI_INT, members, 1, MPI_INT, 0, gather->node);
+
+  MPI_Comm leaders;
+  MPI_Comm_split(game->communicator, node_rank == 0 ? 0 : MPI_UNDEFINED, game->rank, &leaders);
+  if (leaders == MPI_COMM_NULL) {
+    return;
+  }
+
+  int leader_rank, nodes;
+  MPI_Comm_rank(leaders, &leader_rank);
+  MPI_Comm_size(leaders, &nodes);
+
+  int* const sizes = leader_rank == 0 ? (int*)malloc(nodes * sizeof(int)) : NULL;
+  MPI_Gather(&node_size, 1, MPI_INT, sizes, 1, MPI_INT, 0, leaders);
+
+  // The other leaders only keep their own node
+  if (leader_rank != 0) {
+    nodes = 1;
+  }
+  gather->nodes = nodes;
+  gather->node_start = (int*)malloc((nodes + 1) * sizeof(int));
+  gather->node_start[0] = 0;
+  for (int k = 0; k < nodes; k++) {
+    gather->node_start[k + 1] = gather->node_start[k] + (sizes != NULL ? sizes[k] : node_size);
+  }
 
-  // Create cartesian topology
-  int node_dims[2] = {0, 0}; // zero means not fixed, please replace
-  int periods[2] = {0, 0}; // zero means not periodic
+  if (leader_rank == 0) {
+    gather->node_members = (int*)malloc(gather->node_start[nodes] * sizeof(int));
+  } else {
+    gather->node_members = members;
+  }
+  MPI_Gatherv(members, node_size, MPI_INT, gather->node_members, sizes, gather->node_start,
+              MPI_INT, 0, leaders);
+
+  if (leader_rank == 0) {
+    free(members);
+  }
+  free(sizes);
+  MPI_Comm_free(&leaders);
+}
+
+int initialize_game(
+  GameInfo* const game, const MPI_Comm parent,
+  int rows, int cols, const bool* const restrict init,
+  const GameOptions* const options)
+{
+  int rank, size;
+  MPI_Comm_rank(parent, &rank);
+  MPI_Comm_size(parent, &size);
+
+  // Share cols and rows, these where loaded in rank 0. Without initial data
+  // on rank 0 the board starts empty, to be filled by a checkpoint.
+  int has_init = init != NULL;
+  MPI_Bcast(&cols, 1, MPI_INT, 0, parent);
+  MPI_Bcast(&rows, 1, MPI_INT, 0, parent);
+  MPI_Bcast(&has_init, 1, MPI_INT, 0, parent);
+
+  // Create cartesian topology, shaped for the board. Boards that fit no
+  // grid get the default one, which fails the checks below.
+  int node_dims[2] = {0, 0};
+  int periods[2] = {options->periodic, options->periodic}; // zero means not periodic
   int coords[2] = {0, 0};
-  MPI_Dims_create(size, 2, node_dims);
-  MPI_Cart_create(MPI_COMM_WORLD, 2, node_dims, periods, 1, &game->communicator);
-  MPI_Cart_coords(game->communicator, rank, 2, coords);
+  if (!choose_dims(size, rows, cols, options->halo, node_dims)) {
+    MPI_Dims_create(size, 2, node_dims);
+  }
+
+  // Every rank needs at least one row and column. The checks come before
+  // anything is set up, so boards that fail them leak nothing.
+  if (rows < node_dims[0] || cols < node_dims[1]) {
+    if (rank == 0) fprintf(stderr, "board is smaller than the process grid\n");
+    return 1;
+  }
 
-  // Ensure that the data can be spread evenly
-  if (rows % node_dims[0] != 0 || cols % node_dims[1] != 0) {
+  // Pick the update kernel, fails if the CPU can't run the requested one
+  game->rule = options->rule;
+  rule_table(&game->rule, game->rule_table);
+  game->kernel = select_kernel(options->kernel, &game->rule);
+  game->packed_kernel = select_packed_kernel(&game->rule);
+  if (game->kernel == NULL) {
+    if (rank == 0) fprintf(stderr, "requested kernel is not supported\n");
     return 1;
   }
 
+  // The neighbours deep halo blocks must lie within their tiles, the
+  // smallest tiles have the rounded down size
+  if (options->halo > rows / node_dims[0] || options->halo > cols / node_dims[1]) {
+    if (rank == 0) fprintf(stderr, "halo width exceeds the tile size\n");
+    return 1;
+  }
+
+  // Place the ranks ourselves, as reorder knows nothing about the nodes
+  MPI_Comm placed;
+  MPI_Comm_split(parent, 0, placement_key(parent, node_dims, rows, cols), &placed);
+  MPI_Cart_create(placed, 2, node_dims, periods, 0, &game->communicator);
+  MPI_Comm_free(&placed);
+  MPI_Comm_rank(game->communicator, &game->rank);
+  MPI_Cart_coords(game->communicator, game->rank, 2, coords);
+
+  // init is on rank 0 of parent, wherever it landed in the grid
+  int init_rank;
+  MPI_Group parent_group, game_group;
+  MPI_Comm_group(parent, &parent_group);
+  MPI_Comm_group(game->communicator, &game_group);
+  MPI_Group_translate_ranks(parent_group, 1, (int[]){0}, game_group, &init_rank);
+  MPI_Group_free(&parent_group);
+  MPI_Group_free(&game_group);
+
   // Set size properties
   game->node_dims[0] = node_dims[0];
   game->node_dims[1] = node_dims[1];
   game->global_rows = rows;
   game->global_cols = cols;
-  game->local_rows = rows / node_dims[0];
-  game->local_cols = cols / node_dims[1];
+  game->coords[0] = coords[0];
+  game->coords[1] = coords[1];
+
+  // Spread the remainder rows and cols over the first tiles, so tile sizes
+  // differ by at most one
+  game->row_start = (int*)malloc((node_dims[0] + 1) * sizeof(int));
+  game->col_start = (int*)malloc((node_dims[1] + 1) * sizeof(int));
+  for (int i = 0; i <= node_dims[0]; i++) {
+    game->row_start[i] = split_start(rows, node_dims[0], i);
+  }
+  for (int i = 0; i <= node_dims[1]; i++) {
+    game->col_start[i] = split_start(cols, node_dims[1], i);
+  }
+
+  game->local_rows = game->row_start[coords[0] + 1] - game->row_start[coords[0]];
+  game->local_cols = game->col_start[coords[1] + 1] - game->col_start[coords[1]];
+
+  game->halo = options->halo;
+  game->halo_age = options->halo;
 
   // Set rank properties
-  game->topology.north.rank = rank_by_shift(game->communicator, coords, node_dims, -1, 0);
-  game->topology.north_west.rank = rank_by_shift(game->communicator, coords, node_dims, -1, -1);
-  game->topology.north_east.rank = rank_by_shift(game->communicator, coords, node_dims, -1, 1);
-
-  game->topology.south.rank = rank_by_shift(game->communicator, coords, node_dims, 1, 0);
-  game->topology.south_west.rank = rank_by_shift(game->communicator, coords, node_dims, 1, -1);
-  game->topology.south_east.rank = rank_by_shift(game->communicator, coords, node_dims, 1, 1);
-
-  game->topology.east.rank = rank_by_shift(game->communicator, coords, node_dims, 0, 1);
-  game->topology.west.rank = rank_by_shift(game->communicator, coords, node_dims, 0, -1);
-
-  // Create stride types
-  // north -> south
-  set_row_type(&game->topology.north, 1,
-               &game->topology.south, game->local_rows + 1,
-               1, game->local_rows, game->local_cols);
-
-  // north west -> south east
-  set_corner_type(&game->topology.north_west, 1                   , 1,
-                  &game->topology.south_east, game->local_rows + 1, game->local_cols + 1,
-                  game->local_rows, game->local_cols);
-  // north east -> south west
-  set_corner_type(&game->topology.north_east, 1                   , game->local_cols,
-                  &game->topology.south_west, game->local_rows + 1, 0,
-                  game->local_rows, game->local_cols);
-
-  // south -> north
-  set_row_type(&game->topology.south, game->local_rows,
-               &game->topology.north, 0,
-               1, game->local_rows, game->local_cols);
-
-
-  // south west -> north east
-  set_corner_type(&game->topology.south_west, game->local_rows, 1,
-                  &game->topology.north_east, 0               , game->local_cols + 1,
-                  game->local_rows, game->local_cols);
-  // south east -> north west
-  set_corner_type(&game->topology.south_east, game->local_rows, game->local_cols,
-                  &game->topology.north_west, 0               , 0,
-                  game->local_rows, game->local_cols);
-
-  // east -> west
-  set_col_type(&game->topology.east, game->local_cols,
-              &game->topology.west, 0,
-              1, game->local_rows, game->local_cols);
-  // west -> east
-  set_col_type(&game->topology.west, 1,
-              &game->topology.east, game->local_cols + 1,
-              1, game->local_rows, game->local_cols);
+  const bool periodic = options->periodic;
+  game->periodic = periodic;
+  game->topology.north.rank = rank_by_shift(game->communicator, coords, node_dims, -1, 0, periodic);
+  game->topology.north_west.rank = rank_by_shift(game->communicator, coords, node_dims, -1, -1, periodic);
+  game->topology.north_east.rank = rank_by_shift(game->communicator, coords, node_dims, -1, 1, periodic);
+
+  game->topology.south.rank = rank_by_shift(game->communicator, coords, node_dims, 1, 0, periodic);
+  game->topology.south_west.rank = rank_by_shift(game->communicator, coords, node_dims, 1, -1, periodic);
+  game->topology.south_east.rank = rank_by_shift(game->communicator, coords, node_dims, 1, 1, periodic);
+
+  game->topology.east.rank = rank_by_shift(game->communicator, coords, node_dims, 0, 1, periodic);
+  game->topology.west.rank = rank_by_shift(game->communicator, coords, node_dims, 0, -1, periodic);
 
   // Allocate request and status buffers
   game->request = (MPI_Request*) malloc(16 * sizeof(MPI_Request));
   game->status = (MPI_Status*) malloc(16 * sizeof(MPI_Status));
 
-  // Allocate game data buffers
-  int full_size = (game->local_cols + 2) * (game->local_rows + 2);
-  game->current = (bool*)calloc(full_size, sizeof(bool));
-  game->previouse = (bool*)calloc(full_size, sizeof(bool));
+  game->storage = options->storage;
+  game->exchange = options->exchange;
+  create_tile(game);
+  create_gather(game, options->gather == GAME_GATHER_NODE,
+                !options->quiet || options->hashlife > 0);
+  create_board_transfers(game);
 
   // Scatter initial data. This is just for distributing the loaded data,
   // not for handling boundery conditions.
-  scatter_matrix(init, game->global_rows, game->global_cols,
-                 game->current, game->local_rows , game->local_cols ,
-                 node_dims, 0, game->communicator);
+  if (has_init) {
+    scatter_matrix(init, game->current, game, init_rank);
+  }
+
+  convert_tile(game);
+
+  initialize_sparse_game(game, options->sparse);
 
   return 0;
 }
 
+bool* acquire_tile(GameInfo* const game)
+{
+  if (game->storage != GAME_STORAGE_PACKED) {
+    return game->current;
+  }
+
+  bool* const tile = (bool*)malloc((game->local_rows + 2) * (game->local_cols + 2) * sizeof(bool));
+  unpack_tile(game->packed_current, tile, game->local_rows, game->local_cols);
+  return tile;
+}
+
+void release_tile(GameInfo* const game, bool* const tile, const bool modified)
+{
+  if (game->storage != GAME_STORAGE_PACKED) {
+    return;
+  }
+
+  if (modified) {
+    pack_tile(tile, game->packed_current, game->local_rows, game->local_cols);
+  }
+  free(tile);
+}
+
 static inline void destroy_direction_struct(struct TopologyDirection* direction) {
   MPI_Type_free(&direction->send_type);
   MPI_Type_free(&direction->recv_type);
 }
 
+// The cached types that depend on the tiles
+static void free_board_types(GameInfo* const game) {
+  struct GatherCache* const gather = &game->gather;
+  MPI_Type_free(&gather->tile_type);
+
+  if (gather->board_types != NULL) {
+    int size;
+    MPI_Comm_size(game->communicator, &size);
+    for (int other = 0; other < size; other++) {
+      MPI_Type_free(&gather->board_types[other]);
+    }
+    free(gather->board_types);
+    gather->board_types = NULL;
+  }
 
-void destroy_game(GameInfo* const game) {
-  // free communicator
-  MPI_Comm_free(&game->communicator);
+  if (gather->node_types != NULL) {
+    for (int k = 0; k < gather->nodes; k++) {
+      MPI_Type_free(&gather->node_types[k]);
+    }
+    free(gather->node_types);
+    gather->node_types = NULL;
+  }
+
+  free(gather->node_buffer);
+  gather->node_buffer = NULL;
+}
+
+// Counterpart of create_tile() and convert_tile()
+static void free_tile(GameInfo* const game) {
+  free_exchange(game);
+  free_board_types(game);
 
   // free topology direction stucts
   destroy_direction_struct(&game->topology.north);
@@ -261,11 +661,57 @@ void destroy_game(GameInfo* const game) {
   destroy_direction_struct(&game->topology.east);
   destroy_direction_struct(&game->topology.west);
 
+  // free game data buffers
+  free(game->current);
+  free(game->previouse);
+  free(game->packed_current);
+  free(game->packed_previouse);
+  free(game->packed_halo);
+  free(game->halo_buffer);
+  free(game->decay);
+}
+
+void retile_game(GameInfo* const game, const bool* restrict const tile)
+{
+  free_tile(game);
+  destroy_sparse_game(game);
+
+  game->local_rows = game->row_start[game->coords[0] + 1] - game->row_start[game->coords[0]];
+  game->local_cols = game->col_start[game->coords[1] + 1] - game->col_start[game->coords[1]];
+
+  create_tile(game);
+  create_board_transfers(game);
+  memcpy(game->current, tile,
+         (game->local_rows + 2 * game->halo) * padded_cols(game) * sizeof(bool));
+  convert_tile(game);
+
+  initialize_sparse_game(game, game->sparse);
+
+  // The halos belong to the old tile
+  game->halo_age = game->halo;
+}
+
+void destroy_game(GameInfo* const game) {
+  // free decomposition
+  free(game->row_start);
+  free(game->col_start);
+
   // free request and status buffers
   free(game->request);
   free(game->status);
 
-  // free game data buffers
-  free(game->current);
-  free(game->previouse);
+  free_tile(game);
+  destroy_sparse_game(game);
+
+  // free gather buffers
+  free(game->gather.requests);
+  free(game->gather.board);
+  free(game->gather.node_start);
+  free(game->gather.node_members);
+  if (game->gather.node != MPI_COMM_NULL) {
+    MPI_Comm_free(&game->gather.node);
+  }
+
+  // free communicator, last as the cached types are counted by its size
+  MPI_Comm_free(&game->communicator);
 }
@@ -1,11 +1,22 @@
 #pragma once
 
 #include <mpi.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+#include "kernel_game.h"
+#include "options_game.h"
+#include "rule_game.h"
+
 struct TopologyDirection {
   int rank;
 
+  // Geometry of the halo blocks in the padded tile, the block sent to the
+  // neighbour starts at send_offset and the one received at recv_offset
+  int block_size[2];
+  int send_offset[2];
+  int recv_offset[2];
+
   MPI_Datatype send_type;
   MPI_Datatype recv_type;
 };
@@ -23,6 +34,70 @@ struct Topology {
   struct TopologyDirection west;
 };
 
+// Arguments of the neighborhood collective exchange, in the neighbour order
+// of its distributed graph communicator. They must stay in place while the
+// non-blocking collective is in flight.
+struct NeighborExchange {
+  MPI_Comm communicator;
+  int send_count;
+  int recv_count;
+  int counts[8];
+  MPI_Aint send_displacements[8];
+  MPI_Aint recv_displacements[8];
+  MPI_Datatype send_types[8];
+  MPI_Datatype recv_types[8];
+};
+
+// Windows over both byte buffers for the RMA exchange, the group of the
+// neighbours that put into this tile and are put to, and per direction the
+// halo block facing this tile in the tile of that neighbour
+struct RmaExchange {
+  MPI_Win window[2];
+  MPI_Group group;
+  MPI_Datatype target_types[8];
+};
+
+// Tiles of the ranks on a node live in one shared window. source[i] points
+// at the border block of the neighbour recv[i] in each of its two buffers,
+// or is NULL where that neighbour is on another node, and send_shared[i]
+// tells whether send[i] reads our border from the window itself.
+struct SharedExchange {
+  MPI_Comm communicator;
+  MPI_Win window;
+  MPI_Request barrier;
+  const bool* source[8][2];
+  int source_cols[8];
+  bool send_shared[8];
+};
+
+// Cached for scatter_matrix() and gatter_matrix(). tile_type picks the tile
+// out of the padded tile. If the run prints or jumps (whole_boards), rank 0
+// keeps the tile of every rank in the global board in board_types and the
+// board it assembles, set up with the tiles and NULL otherwise. The types
+// follow the tiles, rebalancing rebuilds them.
+//
+// With node leaders the tiles of a node are collected back to back in
+// node_buffer by the first rank of the node, which sends them to rank 0 as
+// one message. Rank 0 receives it with node_types[k], a struct of the
+// board types of the ranks node_members[node_start[k]] ..
+// node_members[node_start[k + 1]] - 1 of node k, the first one its leader.
+// The other leaders only know the members of their own node.
+struct GatherCache {
+  MPI_Datatype tile_type;
+  MPI_Datatype* restrict board_types;
+  bool* restrict board;
+  MPI_Request* restrict requests;
+  bool whole_boards;
+
+  bool by_node;
+  MPI_Comm node;
+  int nodes;
+  int* restrict node_start;
+  int* restrict node_members;
+  bool* restrict node_buffer;
+  MPI_Datatype* restrict node_types;
+};
+
 typedef struct GameInfo {
   // size holders
   int node_dims[2];
@@ -31,13 +106,91 @@ typedef struct GameInfo {
   int local_rows;
   int local_cols;
 
+  // position in the process grid, and the first global row/col of each
+  // process row/col followed by the board size, so the tile of this rank
+  // spans rows row_start[coords[0]] .. row_start[coords[0] + 1] - 1
+  int coords[2];
+  int* restrict row_start;
+  int* restrict col_start;
+
+  // rank in the cartesian communicator, and whether the board wraps around
+  int rank;
+  bool periodic;
+
+  // width of the ghost cell ring around the tile, and the number of
+  // generations computed since the halos were last exchanged
+  int halo;
+  int halo_age;
+
+  // cell storage, selects the layout of the game data holders
+  enum GameStorage storage;
+
+  // update kernels for byte and packed storage
+  GameKernel kernel;
+  PackedKernel packed_kernel;
+
+  // rule of the game, and its lookup table for the byte kernels
+  GameRule rule;
+  uint8_t rule_table[RULE_TABLE_SIZE];
+
+  // halo exchange for byte storage
+  enum GameExchange exchange;
+
   // game data holders
   bool* restrict current;
   bool* restrict previouse;
 
+  // number of generations each dying cell of a Generations rule has been
+  // dying, laid out like current, or NULL for life-like rules. Only live
+  // cells count as neighbours, so this never needs a halo exchange.
+  uint8_t* restrict decay;
+
+  // bit packed game data holders, used instead of current and previouse for
+  // GAME_STORAGE_PACKED (see packed_game.h)
+  int packed_cols;
+  uint64_t* restrict packed_current;
+  uint64_t* restrict packed_previouse;
+
+  // contiguous column buffers for the packed east/west halo exchange, laid
+  // out as send west, send east, recv west, recv east
+  uint64_t* restrict packed_halo;
+
+  // contiguous column buffers for the aggregated byte exchange, laid out
+  // like packed_halo with halo x local_rows cells each
+  bool* restrict halo_buffer;
+
+  // the two byte buffers in the order they were allocated. The persistent
+  // requests and the RMA windows are bound to each of them, as current and
+  // previouse swap every generation.
+  bool* exchange_tile[2];
+
+  // persistent halo requests per buffer, and the direction of each pair
+  int persistent_count[2];
+  int persistent_direction[8];
+  MPI_Request* restrict persistent_request;
+
+  // neighborhood collective exchange
+  struct NeighborExchange neighbor;
+
+  // RMA exchange
+  struct RmaExchange rma;
+
+  // shared memory exchange within a node
+  struct SharedExchange shared;
+
+  // change map and active block list for sparse updates, see sparse_game.h
+  bool sparse;
+  int block_rows;
+  int block_cols;
+  bool* restrict block_changed;
+  int* restrict active_blocks;
+
   // Topology information and buffers
   struct Topology topology;
 
+  // gather and scatter of whole boards
+  struct GatherCache gather;
+
   // Request and status buffers for MPI
   MPI_Request* restrict request;
   MPI_Status* restrict status;
@@ -46,9 +199,56 @@ typedef struct GameInfo {
   MPI_Comm communicator;
 } GameInfo;
 
+// Row length of the padded tile, and index of the first cell of the tile
+static inline int padded_cols(const GameInfo* const game) {
+  return game->local_cols + 2 * game->halo;
+}
+
+static inline int interior_offset(const GameInfo* const game) {
+  return game->halo * padded_cols(game) + game->halo;
+}
+
+// Start of part i when splitting total into parts that differ by at most one
+static inline int split_start(const int total, const int parts, const int i) {
+  const int remainder = total % parts;
+  return i * (total / parts) + (i < remainder ? i : remainder);
+}
+
+// Global offset and size of the tile owned by a rank
+static inline void rank_tile(
+  const GameInfo* const game, const int rank,
+  int* restrict const offset, int* restrict const size)
+{
+  int coords[2] = {0, 0};
+  MPI_Cart_coords(game->communicator, rank, 2, coords);
+
+  offset[0] = game->row_start[coords[0]];
+  offset[1] = game->col_start[coords[1]];
+  size[0] = game->row_start[coords[0] + 1] - offset[0];
+  size[1] = game->col_start[coords[1] + 1] - offset[1];
+}
+
+// Set up the decomposition over the ranks of parent and scatter init from
+// its rank 0. If rank 0 passes no init the board starts empty.
 int initialize_game(
-  GameInfo* const game,
-  const int size, const int rank,
-  int rows, int cols, const bool* const restrict init);
+  GameInfo* const game, const MPI_Comm parent,
+  int rows, int cols, const bool* const restrict init,
+  const GameOptions* const options);
+
+// Distribute a global_rows x global_cols board on sender_rank into the
+// padded byte tiles of all ranks
+int scatter_matrix(
+  const bool* restrict const global_matrix,
+        bool* restrict const local_matrix,
+  GameInfo* const game, const int sender_rank);
+
+// Byte view of the current padded tile. For packed storage this is a
+// temporary copy, which release_tile() packs back if it was modified.
+bool* acquire_tile(GameInfo* const game);
+void release_tile(GameInfo* const game, bool* const tile, const bool modified);
+
+// Rebuild the halo datatypes and buffers after row_start/col_start changed,
+// taking the cells from a padded byte tile of the new size
+void retile_game(GameInfo* const game, const bool* restrict const tile);
 
 void destroy_game(GameInfo* const game);
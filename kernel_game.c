@@ -0,0 +1,522 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define KERNEL_NEON 1
+#endif
+
+#include "kernel_game.h"
+#include "packed_game.h"
+
+void update_scalar_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  for (int r = row_begin; r < row_end; r++) {
+    for (int c = col_begin; c < col_end; c++) {
+      int sum = current[(r - 1) * cols_pad + c - 1] + current[(r - 1) * cols_pad + c + 0] + current[(r - 1) * cols_pad + c + 1]
+              + current[(r + 0) * cols_pad + c - 1] +                  0                  + current[(r + 0) * cols_pad + c + 1]
+              + current[(r + 1) * cols_pad + c - 1] + current[(r + 1) * cols_pad + c + 0] + current[(r + 1) * cols_pad + c + 1];
+
+      // Update next array, later next and current will be swapped
+      next[r * cols_pad + c] = table[current[r * cols_pad + c] * RULE_TABLE_ALIVE + sum];
+    }
+  }
+}
+
+// Sum of the three cells in column c of rows r - 1, r and r + 1
+static inline uint8_t column_sum(
+  const uint8_t* restrict const row, const int cols_pad, const int c)
+{
+  return row[c - cols_pad] + row[c] + row[c + cols_pad];
+}
+
+// The vector kernels below all follow the same scheme for one row: the
+// vertical sum of the three rows is computed once per vector, the horizontal
+// neighbours are then obtained by shifting the previous/next vertical sums in
+// by one byte. The neighbour count is the 3x3 sum minus the cell itself.
+// For B3/S23 a cell is alive next generation iff (count | alive) == 3, any
+// other rule looks the count up in the birth and survive halves of the rule
+// table with a byte shuffle and picks one by alive. Each kernel is compiled
+// once per case, with conway a constant. Columns left over by the vector
+// width are finished by the scalar kernel.
+
+#ifdef KERNEL_X86
+
+__attribute__((target("avx2")))
+static inline __m256i column_sum_avx2(
+  const uint8_t* restrict const row, const int cols_pad, const int c)
+{
+  const __m256i above = _mm256_loadu_si256((const __m256i*)&row[c - cols_pad]);
+  const __m256i self  = _mm256_loadu_si256((const __m256i*)&row[c]);
+  const __m256i below = _mm256_loadu_si256((const __m256i*)&row[c + cols_pad]);
+  return _mm256_add_epi8(_mm256_add_epi8(above, self), below);
+}
+
+__attribute__((target("avx2")))
+static inline void update_avx2_rows(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end, const bool conway)
+{
+  const int width = 32;
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i three = _mm256_set1_epi8(3);
+  const __m256i birth = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table));
+  const __m256i survive = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i*)&table[RULE_TABLE_ALIVE]));
+
+  for (int r = row_begin; r < row_end; r++) {
+    const uint8_t* restrict const row = (const uint8_t*)&current[r * cols_pad];
+    uint8_t* restrict const out = (uint8_t*)&next[r * cols_pad];
+
+    int c = col_begin;
+    if (col_end - col_begin >= width) {
+      __m256i prev = _mm256_set1_epi8(column_sum(row, cols_pad, c - 1));
+      __m256i cur = column_sum_avx2(row, cols_pad, c);
+
+      for (; c + width <= col_end; c += width) {
+        const __m256i next_sum = (c + 2 * width <= col_end)
+          ? column_sum_avx2(row, cols_pad, c + width)
+          : _mm256_set1_epi8(column_sum(row, cols_pad, c + width));
+
+        // Shift in the last byte of prev and the first byte of next
+        const __m256i west = _mm256_alignr_epi8(
+          cur, _mm256_permute2x128_si256(prev, cur, 0x21), 15);
+        const __m256i east = _mm256_alignr_epi8(
+          _mm256_permute2x128_si256(cur, next_sum, 0x21), cur, 1);
+
+        const __m256i alive = _mm256_loadu_si256((const __m256i*)&row[c]);
+        const __m256i sum = _mm256_add_epi8(_mm256_add_epi8(west, cur), east);
+        const __m256i count = _mm256_sub_epi8(sum, alive);
+        if (conway) {
+          const __m256i born = _mm256_cmpeq_epi8(_mm256_or_si256(count, alive), three);
+          _mm256_storeu_si256((__m256i*)&out[c], _mm256_and_si256(born, one));
+        } else {
+          // alive - 1 has the top bit set for dead cells
+          const __m256i born = _mm256_shuffle_epi8(birth, count);
+          const __m256i stays = _mm256_shuffle_epi8(survive, count);
+          _mm256_storeu_si256((__m256i*)&out[c],
+                              _mm256_blendv_epi8(stays, born, _mm256_sub_epi8(alive, one)));
+        }
+
+        prev = cur;
+        cur = next_sum;
+      }
+    }
+
+    update_scalar_kernel(current, next, cols_pad, table, r, r + 1, c, col_end);
+  }
+}
+
+__attribute__((target("avx2")))
+static void update_avx2_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_avx2_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, false);
+}
+
+__attribute__((target("avx2")))
+static void update_avx2_conway_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_avx2_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, true);
+}
+
+__attribute__((target("avx512bw")))
+static inline __m512i column_sum_avx512(
+  const uint8_t* restrict const row, const int cols_pad, const int c)
+{
+  const __m512i above = _mm512_loadu_si512((const void*)&row[c - cols_pad]);
+  const __m512i self  = _mm512_loadu_si512((const void*)&row[c]);
+  const __m512i below = _mm512_loadu_si512((const void*)&row[c + cols_pad]);
+  return _mm512_add_epi8(_mm512_add_epi8(above, self), below);
+}
+
+__attribute__((target("avx512bw")))
+static inline void update_avx512_rows(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end, const bool conway)
+{
+  const int width = 64;
+  const __m512i one = _mm512_set1_epi8(1);
+  const __m512i three = _mm512_set1_epi8(3);
+  const __m512i birth = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)table));
+  const __m512i survive = _mm512_broadcast_i32x4(
+    _mm_loadu_si128((const __m128i*)&table[RULE_TABLE_ALIVE]));
+
+  for (int r = row_begin; r < row_end; r++) {
+    const uint8_t* restrict const row = (const uint8_t*)&current[r * cols_pad];
+    uint8_t* restrict const out = (uint8_t*)&next[r * cols_pad];
+
+    int c = col_begin;
+    if (col_end - col_begin >= width) {
+      __m512i prev = _mm512_set1_epi8(column_sum(row, cols_pad, c - 1));
+      __m512i cur = column_sum_avx512(row, cols_pad, c);
+
+      for (; c + width <= col_end; c += width) {
+        const __m512i next_sum = (c + 2 * width <= col_end)
+          ? column_sum_avx512(row, cols_pad, c + width)
+          : _mm512_set1_epi8(column_sum(row, cols_pad, c + width));
+
+        // Byte shifts only work within 128 bit lanes, so first line up the
+        // neighbouring lanes with a 64 bit element shift
+        const __m512i west = _mm512_alignr_epi8(
+          cur, _mm512_alignr_epi64(cur, prev, 6), 15);
+        const __m512i east = _mm512_alignr_epi8(
+          _mm512_alignr_epi64(next_sum, cur, 2), cur, 1);
+
+        const __m512i alive = _mm512_loadu_si512((const void*)&row[c]);
+        const __m512i sum = _mm512_add_epi8(_mm512_add_epi8(west, cur), east);
+        const __m512i count = _mm512_sub_epi8(sum, alive);
+        if (conway) {
+          const __mmask64 born = _mm512_cmpeq_epi8_mask(_mm512_or_si512(count, alive), three);
+          _mm512_storeu_si512((void*)&out[c], _mm512_maskz_mov_epi8(born, one));
+        } else {
+          const __m512i born = _mm512_shuffle_epi8(birth, count);
+          const __m512i stays = _mm512_shuffle_epi8(survive, count);
+          _mm512_storeu_si512((void*)&out[c],
+                              _mm512_mask_blend_epi8(_mm512_test_epi8_mask(alive, alive), born, stays));
+        }
+
+        prev = cur;
+        cur = next_sum;
+      }
+    }
+
+    update_scalar_kernel(current, next, cols_pad, table, r, r + 1, c, col_end);
+  }
+}
+
+__attribute__((target("avx512bw")))
+static void update_avx512_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_avx512_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, false);
+}
+
+__attribute__((target("avx512bw")))
+static void update_avx512_conway_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_avx512_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, true);
+}
+
+#endif
+
+#ifdef KERNEL_NEON
+
+static inline uint8x16_t column_sum_neon(
+  const uint8_t* restrict const row, const int cols_pad, const int c)
+{
+  return vaddq_u8(vaddq_u8(vld1q_u8(&row[c - cols_pad]), vld1q_u8(&row[c])),
+                  vld1q_u8(&row[c + cols_pad]));
+}
+
+// Byte shuffle of a 16 entry table, 32 bit ARM only has 8 byte lookups
+static inline uint8x16_t lookup_neon(const uint8_t* restrict const table, const uint8x16_t index)
+{
+#ifdef __aarch64__
+  return vqtbl1q_u8(vld1q_u8(table), index);
+#else
+  const uint8x8x2_t halves = {{vld1_u8(table), vld1_u8(&table[8])}};
+  return vcombine_u8(vtbl2_u8(halves, vget_low_u8(index)), vtbl2_u8(halves, vget_high_u8(index)));
+#endif
+}
+
+static inline void update_neon_rows(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end, const bool conway)
+{
+  const int width = 16;
+  const uint8x16_t one = vdupq_n_u8(1);
+  const uint8x16_t three = vdupq_n_u8(3);
+
+  for (int r = row_begin; r < row_end; r++) {
+    const uint8_t* restrict const row = (const uint8_t*)&current[r * cols_pad];
+    uint8_t* restrict const out = (uint8_t*)&next[r * cols_pad];
+
+    int c = col_begin;
+    if (col_end - col_begin >= width) {
+      uint8x16_t prev = vdupq_n_u8(column_sum(row, cols_pad, c - 1));
+      uint8x16_t cur = column_sum_neon(row, cols_pad, c);
+
+      for (; c + width <= col_end; c += width) {
+        const uint8x16_t next_sum = (c + 2 * width <= col_end)
+          ? column_sum_neon(row, cols_pad, c + width)
+          : vdupq_n_u8(column_sum(row, cols_pad, c + width));
+
+        const uint8x16_t west = vextq_u8(prev, cur, 15);
+        const uint8x16_t east = vextq_u8(cur, next_sum, 1);
+
+        const uint8x16_t alive = vld1q_u8(&row[c]);
+        const uint8x16_t sum = vaddq_u8(vaddq_u8(west, cur), east);
+        const uint8x16_t count = vsubq_u8(sum, alive);
+        if (conway) {
+          const uint8x16_t born = vceqq_u8(vorrq_u8(count, alive), three);
+          vst1q_u8(&out[c], vandq_u8(born, one));
+        } else {
+          const uint8x16_t born = lookup_neon(table, count);
+          const uint8x16_t stays = lookup_neon(&table[RULE_TABLE_ALIVE], count);
+          vst1q_u8(&out[c], vbslq_u8(vceqq_u8(alive, one), stays, born));
+        }
+
+        prev = cur;
+        cur = next_sum;
+      }
+    }
+
+    update_scalar_kernel(current, next, cols_pad, table, r, r + 1, c, col_end);
+  }
+}
+
+static void update_neon_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_neon_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, false);
+}
+
+static void update_neon_conway_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
+{
+  update_neon_rows(current, next, cols_pad, table, row_begin, row_end, col_begin, col_end, true);
+}
+
+#endif
+
+GameKernel select_kernel(const enum GameKernelType type, const GameRule* const rule)
+{
+  const bool conway = is_conway_rule(rule);
+
+  switch (type) {
+    case GAME_KERNEL_SCALAR:
+      return update_scalar_kernel;
+
+    case GAME_KERNEL_AVX2:
+#ifdef KERNEL_X86
+      if (__builtin_cpu_supports("avx2")) return conway ? update_avx2_conway_kernel : update_avx2_kernel;
+#endif
+      return NULL;
+
+    case GAME_KERNEL_AVX512:
+#ifdef KERNEL_X86
+      if (__builtin_cpu_supports("avx512bw")) return conway ? update_avx512_conway_kernel : update_avx512_kernel;
+#endif
+      return NULL;
+
+    case GAME_KERNEL_NEON:
+#ifdef KERNEL_NEON
+      return conway ? update_neon_conway_kernel : update_neon_kernel;
+#endif
+      return NULL;
+
+    case GAME_KERNEL_AUTO:
+    default:
+      break;
+  }
+
+  // Widest supported vector kernel first
+  GameKernel kernel = NULL;
+  if ((kernel = select_kernel(GAME_KERNEL_AVX512, rule))) return kernel;
+  if ((kernel = select_kernel(GAME_KERNEL_AVX2, rule))) return kernel;
+  if ((kernel = select_kernel(GAME_KERNEL_NEON, rule))) return kernel;
+  return update_scalar_kernel;
+}
+
+//
+// Packed kernels
+//
+
+// Bit-sliced adders, each bit position is an independent cell
+static inline void half_adder(
+  const uint64_t a, const uint64_t b,
+  uint64_t* const sum, uint64_t* const carry)
+{
+  *sum = a ^ b;
+  *carry = a & b;
+}
+
+static inline void full_adder(
+  const uint64_t a, const uint64_t b, const uint64_t c,
+  uint64_t* const sum, uint64_t* const carry)
+{
+  const uint64_t t = a ^ b;
+  *sum = t ^ c;
+  *carry = (a & b) | (t & c);
+}
+
+// Shift a word such that each bit holds its west/east neighbour, borrowing
+// the edge bit from the adjacent word of the row.
+static inline uint64_t west_of(const uint64_t* restrict const row, const int w)
+{
+  return (row[w] << 1) | (w > 0 ? row[w - 1] >> (PACKED_WORD_BITS - 1) : 0);
+}
+
+static inline uint64_t east_of(const uint64_t* restrict const row, const int w, const int words)
+{
+  return (row[w] >> 1) | (w + 1 < words ? row[w + 1] << (PACKED_WORD_BITS - 1) : 0);
+}
+
+// Cells whose 4 bit neighbour count is in the bit set counts. With counts a
+// constant the loop unrolls and only the terms of its counts are left.
+static inline uint64_t packed_count_in(
+  const uint16_t counts,
+  const uint64_t ones, const uint64_t twos, const uint64_t fours, const uint64_t eights)
+{
+  uint64_t result = 0;
+  for (int n = 0; n <= 8; n++) {
+    if ((counts >> n) & 1) {
+      result |= (n & 1 ? ones : ~ones) & (n & 2 ? twos : ~twos) &
+                (n & 4 ? fours : ~fours) & (n & 8 ? eights : ~eights);
+    }
+  }
+  return result;
+}
+
+// The adders sum up the three cells above and below and the two beside into
+// a 4 bit count per cell. Compiled once per rule with birth and survive
+// constants, B3/S23 keeps its shorter expression.
+static inline __attribute__((always_inline)) void update_packed_rows(
+  const uint64_t* restrict const current, uint64_t* restrict const next_tile,
+  const int words, const int last_col,
+  const int row_begin, const int row_end,
+  const int word_begin, const int word_end,
+  const uint16_t birth, const uint16_t survive)
+{
+  const bool conway = birth == CONWAY_RULE.birth && survive == CONWAY_RULE.survive;
+
+  for (int r = row_begin; r < row_end; r++) {
+    const uint64_t* restrict const above = &current[(r - 1) * words];
+    const uint64_t* restrict const row   = &current[(r + 0) * words];
+    const uint64_t* restrict const below = &current[(r + 1) * words];
+    uint64_t* restrict const next = &next_tile[r * words];
+
+    for (int w = word_begin; w < word_end; w++) {
+      // Sum the three cells above and below, and the two cells beside
+      uint64_t above_ones, above_twos;
+      full_adder(west_of(above, w), above[w], east_of(above, w, words),
+                 &above_ones, &above_twos);
+      uint64_t below_ones, below_twos;
+      full_adder(west_of(below, w), below[w], east_of(below, w, words),
+                 &below_ones, &below_twos);
+      uint64_t side_ones, side_twos;
+      half_adder(west_of(row, w), east_of(row, w, words),
+                 &side_ones, &side_twos);
+
+      // Add the three 2-bit partial sums into a 4-bit neighbour count
+      uint64_t ones, ones_carry;
+      full_adder(above_ones, below_ones, side_ones, &ones, &ones_carry);
+      uint64_t twos_partial, fours_partial;
+      full_adder(above_twos, below_twos, side_twos, &twos_partial, &fours_partial);
+      uint64_t twos, twos_carry;
+      half_adder(twos_partial, ones_carry, &twos, &twos_carry);
+      uint64_t fours, eights;
+      half_adder(fours_partial, twos_carry, &fours, &eights);
+
+      // B3/S23 is sum == 3 || (sum == 2 && alive)
+      uint64_t alive = conway ?
+        twos & ~fours & ~eights & (ones | row[w]) :
+        (packed_count_in(birth, ones, twos, fours, eights) & ~row[w]) |
+        (packed_count_in(survive, ones, twos, fours, eights) & row[w]);
+
+      // Keep halo and padding bits zero, they are refilled by the exchange
+      const int first = w * PACKED_WORD_BITS;
+      if (first == 0) {
+        alive &= ~(uint64_t)1;
+      }
+      if (last_col < first + PACKED_WORD_BITS) {
+        alive &= ((uint64_t)1 << (last_col - first)) - 1;
+      }
+
+      next[w] = alive;
+    }
+  }
+}
+
+#define PACKED_KERNEL(name, birth, survive)                                      \
+  static void update_packed_##name##_kernel(                                     \
+    const uint64_t* restrict const current, uint64_t* restrict const next,       \
+    const int words, const int last_col,                                         \
+    const int row_begin, const int row_end,                                      \
+    const int word_begin, const int word_end)                                    \
+  {                                                                              \
+    update_packed_rows(current, next, words, last_col, row_begin, row_end,       \
+                       word_begin, word_end, birth, survive);                    \
+  }
+
+// The life-like rules parse_rule() knows by name, as their name, birth and
+// survive counts
+#define COUNT(n) (1 << (n))
+#define PACKED_RULES(RULE)                                                                  \
+  RULE(life,     COUNT(3),                                  COUNT(2) | COUNT(3))            \
+  RULE(highlife, COUNT(3) | COUNT(6),                       COUNT(2) | COUNT(3))            \
+  RULE(daynight, COUNT(3) | COUNT(6) | COUNT(7) | COUNT(8),                                 \
+                 COUNT(3) | COUNT(4) | COUNT(6) | COUNT(7) | COUNT(8))                      \
+  RULE(seeds,    COUNT(2),                                  0)
+
+PACKED_RULES(PACKED_KERNEL)
+
+#define PACKED_ENTRY(name, birth, survive) {birth, survive, update_packed_##name##_kernel},
+
+static const struct {
+  uint16_t birth;
+  uint16_t survive;
+  PackedKernel kernel;
+} PACKED_KERNELS[] = {
+  PACKED_RULES(PACKED_ENTRY)
+};
+
+PackedKernel select_packed_kernel(const GameRule* const rule)
+{
+  for (size_t i = 0; i < sizeof(PACKED_KERNELS) / sizeof(PACKED_KERNELS[0]); i++) {
+    if (rule->states == 2 && rule->birth == PACKED_KERNELS[i].birth &&
+        rule->survive == PACKED_KERNELS[i].survive) {
+      return PACKED_KERNELS[i].kernel;
+    }
+  }
+  return NULL;
+}
+
+const char* kernel_name(const GameKernel kernel)
+{
+#ifdef KERNEL_X86
+  if (kernel == update_avx2_kernel || kernel == update_avx2_conway_kernel) return "avx2";
+  if (kernel == update_avx512_kernel || kernel == update_avx512_conway_kernel) return "avx512";
+#endif
+#ifdef KERNEL_NEON
+  if (kernel == update_neon_kernel || kernel == update_neon_conway_kernel) return "neon";
+#endif
+  return "scalar";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "options_game.h"
+#include "rule_game.h"
+
+// Byte tile update kernels. Each kernel computes the next generation of the
+// cells in rows [row_begin, row_end) and columns [col_begin, col_end) of a
+// padded tile with cols_pad bytes per row, reading the surrounding ring of
+// cells from current and writing only the region in next. The rule comes as
+// the lookup table of rule_table().
+typedef void (*GameKernel)(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end);
+
+void update_scalar_kernel(
+  const bool* restrict const current, bool* restrict const next,
+  const int cols_pad, const uint8_t* restrict const table,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end);
+
+// Returns the kernel for the requested type, GAME_KERNEL_AUTO picks the
+// widest one supported by the CPU. The vector kernels have a variant
+// specialized for B3/S23, which is picked for that rule. Returns NULL if
+// the CPU or the build doesn't support the requested type.
+GameKernel select_kernel(const enum GameKernelType type, const GameRule* const rule);
+
+const char* kernel_name(const GameKernel kernel);
+
+// Packed tile update kernels, on tiles of words 64 bit words per row with
+// one cell per bit. Each kernel computes rows [row_begin, row_end) and
+// words [word_begin, word_end) of next from current, keeping the halo
+// column 0 and the columns past last_col zero. There is one kernel per
+// named life-like rule, its birth and survive conditions compiled into
+// a bit-sliced expression of the neighbour count.
+typedef void (*PackedKernel)(
+  const uint64_t* restrict const current, uint64_t* restrict const next,
+  const int words, const int last_col,
+  const int row_begin, const int row_end,
+  const int word_begin, const int word_end);
+
+// Returns the packed kernel of the rule, NULL if there is none
+PackedKernel select_packed_kernel(const GameRule* const rule);
@@ -0,0 +1,396 @@
+
+#include <mpi.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "cycle_game.h"
+#include "load_game.h"
+
+static const char PACKED_PATTERN_MAGIC[8] = {'G', 'O', 'L', 'P', 'A', 'C', 'K', '\0'};
+static const int32_t PACKED_PATTERN_VERSION = 1;
+
+static inline bool has_suffix(const char* const text, const char* const suffix)
+{
+  const size_t text_length = strlen(text);
+  const size_t suffix_length = strlen(suffix);
+  return text_length >= suffix_length &&
+         strcmp(&text[text_length - suffix_length], suffix) == 0;
+}
+
+static inline int min_int(const int a, const int b) { return a < b ? a : b; }
+static inline int max_int(const int a, const int b) { return a > b ? a : b; }
+
+// The cells are broadcast with an int count
+static inline bool pattern_fits(const Pattern* const pattern)
+{
+  return (size_t)pattern->rows * pattern->cols <= INT_MAX;
+}
+
+// Read a whole text file into a NUL terminated buffer
+static char* read_text_file(const char* const path)
+{
+  FILE* const file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  long length = -1;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    length = ftell(file);
+  }
+  if (length < 0 || fseek(file, 0, SEEK_SET) != 0) {
+    fclose(file);
+    return NULL;
+  }
+
+  char* const text = (char*)malloc((size_t)length + 1);
+  if (text == NULL || fread(text, 1, length, file) != (size_t)length) {
+    free(text);
+    fclose(file);
+    return NULL;
+  }
+  text[length] = '\0';
+  fclose(file);
+
+  return text;
+}
+
+// RLE: '#' comment lines, a "x = cols, y = rows" header line, then runs of
+// <count><tag> where b or . is dead, $ ends a row and ! ends the pattern.
+// Any other letter is an alive cell, so multi-state patterns load as alive.
+static int parse_rle(Pattern* const pattern, const char* text)
+{
+  // Find the header line
+  while (*text == '#' || *text == '\n' || *text == '\r') {
+    text = strchr(text, '\n');
+    if (text == NULL) {
+      return 1;
+    }
+    text++;
+  }
+
+  if (sscanf(text, " x = %d , y = %d", &pattern->cols, &pattern->rows) != 2 ||
+      pattern->rows <= 0 || pattern->cols <= 0 || !pattern_fits(pattern)) {
+    return 1;
+  }
+
+  text = strchr(text, '\n');
+  if (text == NULL) {
+    return 1;
+  }
+
+  pattern->cells = (bool*)calloc((size_t)pattern->rows * pattern->cols, sizeof(bool));
+  if (pattern->cells == NULL) {
+    return 1;
+  }
+
+  // Runs past the header size are clipped, so r and c never pass rows and cols
+  int r = 0, c = 0, count = 0;
+  for (; *text != '\0' && *text != '!'; text++) {
+    const int run = count > 0 ? count : 1;
+
+    if (isdigit((unsigned char)*text)) {
+      const int digit = *text - '0';
+      if (count > (INT_MAX - digit) / 10) {
+        return 1;
+      }
+      count = count * 10 + digit;
+      continue;
+    } else if (*text == 'b' || *text == '.') {
+      c += min_int(run, pattern->cols - c);
+    } else if (*text == '$') {
+      r += min_int(run, pattern->rows - r);
+      c = 0;
+    } else if (isalpha((unsigned char)*text)) {
+      const int alive = min_int(run, pattern->cols - c);
+      for (int i = 0; i < alive; i++, c++) {
+        if (r < pattern->rows) {
+          pattern->cells[r * pattern->cols + c] = 1;
+        }
+      }
+    }
+
+    count = 0;
+  }
+
+  return 0;
+}
+
+// Plaintext: '!' comment lines, then one line per row with O or * for alive
+// cells. Rows may be shorter than the widest one.
+static int parse_cells(Pattern* const pattern, const char* const text)
+{
+  // First pass for the size
+  pattern->rows = 0;
+  pattern->cols = 0;
+  for (const char* line = text; *line != '\0';) {
+    const char* end = strchr(line, '\n');
+    if (end == NULL) {
+      end = line + strlen(line);
+    }
+
+    if (*line != '!') {
+      if (end - line > INT_MAX || pattern->rows == INT_MAX) {
+        return 1;
+      }
+      int length = end - line;
+      if (length > 0 && line[length - 1] == '\r') {
+        length--;
+      }
+      pattern->rows++;
+      pattern->cols = max_int(pattern->cols, length);
+    }
+
+    line = *end == '\0' ? end : end + 1;
+  }
+
+  if (pattern->rows == 0 || pattern->cols == 0 || !pattern_fits(pattern)) {
+    return 1;
+  }
+
+  // Second pass for the cells
+  pattern->cells = (bool*)calloc((size_t)pattern->rows * pattern->cols, sizeof(bool));
+  if (pattern->cells == NULL) {
+    return 1;
+  }
+
+  int r = 0;
+  for (const char* line = text; *line != '\0';) {
+    const char* end = strchr(line, '\n');
+    if (end == NULL) {
+      end = line + strlen(line);
+    }
+
+    if (*line != '!') {
+      for (int c = 0; line + c < end; c++) {
+        if (line[c] == 'O' || line[c] == '*') {
+          pattern->cells[r * pattern->cols + c] = 1;
+        }
+      }
+      r++;
+    }
+
+    line = *end == '\0' ? end : end + 1;
+  }
+
+  return 0;
+}
+
+static int read_packed_header(
+  const char* const path, struct PackedPatternHeader* const header,
+  const MPI_Comm communicator)
+{
+  MPI_File file;
+  if (MPI_File_open(communicator, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    return 1;
+  }
+
+  int ierror = MPI_File_read_at_all(file, 0, header, sizeof(*header), MPI_BYTE,
+                                    MPI_STATUS_IGNORE);
+  MPI_File_close(&file);
+
+  if (ierror != MPI_SUCCESS ||
+      memcmp(header->magic, PACKED_PATTERN_MAGIC, sizeof(PACKED_PATTERN_MAGIC)) != 0 ||
+      header->version != PACKED_PATTERN_VERSION ||
+      header->rows <= 0 || header->cols <= 0) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int open_pattern(Pattern* const pattern, const char* const path, const MPI_Comm communicator)
+{
+  int rank;
+  MPI_Comm_rank(communicator, &rank);
+
+  pattern->path = path;
+  pattern->rows = 0;
+  pattern->cols = 0;
+  pattern->cells = NULL;
+
+  if (has_suffix(path, ".rle")) {
+    pattern->format = PATTERN_RLE;
+  } else if (has_suffix(path, ".cells")) {
+    pattern->format = PATTERN_CELLS;
+  } else {
+    pattern->format = PATTERN_PACKED;
+  }
+
+  // Packed patterns are read in parallel later on, only the size is needed
+  if (pattern->format == PATTERN_PACKED) {
+    struct PackedPatternHeader header;
+    if (read_packed_header(path, &header, communicator)) {
+      return 1;
+    }
+
+    pattern->rows = header.rows;
+    pattern->cols = header.cols;
+    return 0;
+  }
+
+  // rank 0 parses text patterns
+  int ierror = 0;
+  if (rank == 0) {
+    char* const text = read_text_file(path);
+    if (text == NULL) {
+      ierror = 1;
+    } else if (pattern->format == PATTERN_RLE) {
+      ierror = parse_rle(pattern, text);
+    } else {
+      ierror = parse_cells(pattern, text);
+    }
+    free(text);
+  }
+
+  MPI_Bcast(&ierror, 1, MPI_INT, 0, communicator);
+  if (ierror) {
+    close_pattern(pattern);
+    return 1;
+  }
+
+  MPI_Bcast(&pattern->rows, 1, MPI_INT, 0, communicator);
+  MPI_Bcast(&pattern->cols, 1, MPI_INT, 0, communicator);
+  if (rank != 0) {
+    pattern->cells = (bool*)malloc((size_t)pattern->rows * pattern->cols * sizeof(bool));
+  }
+  MPI_Bcast(pattern->cells, pattern->rows * pattern->cols, MPI_C_BOOL, 0, communicator);
+
+  return 0;
+}
+
+// Every rank reads the bytes covering the part of the pattern that overlaps
+// its tile, through a file view, and expands the bits into its tile. Tiles
+// next to each other share the bytes across their boundary, so the reads are
+// independent: overlapping collective reads are not handled correctly by all
+// MPI-IO implementations (OMPIO in Open MPI 4.1 returns wrong data).
+static int place_packed_pattern(
+  GameInfo* const game, const Pattern* const pattern, bool* restrict const tile,
+  const int row_offset, const int col_offset,
+  const int* restrict const rows, const int* restrict const cols,
+  const int* restrict const tile_offset)
+{
+  MPI_File file;
+  if (MPI_File_open(game->communicator, pattern->path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    return 1;
+  }
+
+  const int row_bytes = (pattern->cols + 7) / 8;
+  const int cols_pad = padded_cols(game);
+  const bool overlap = rows[0] < rows[1] && cols[0] < cols[1];
+
+  // Byte columns of the pattern that hold the overlapping cells
+  const int byte_begin = overlap ? (cols[0] - col_offset) / 8 : 0;
+  const int byte_end = overlap ? (cols[1] - 1 - col_offset) / 8 + 1 : 0;
+  const int read_rows = overlap ? rows[1] - rows[0] : 0;
+  const int read_bytes = byte_end - byte_begin;
+
+  // Ranks without overlap read nothing, but set_view is collective
+  MPI_Datatype file_type = MPI_BYTE;
+  if (overlap) {
+    int pattern_size[] = {pattern->rows, row_bytes};
+    int read_size[]    = {read_rows, read_bytes};
+    int read_offset[]  = {rows[0] - row_offset, byte_begin};
+    MPI_Type_create_subarray(2, pattern_size, read_size, read_offset,
+                             MPI_ORDER_C, MPI_BYTE, &file_type);
+    MPI_Type_commit(&file_type);
+  }
+
+  MPI_File_set_view(file, sizeof(struct PackedPatternHeader), MPI_BYTE, file_type,
+                    "native", MPI_INFO_NULL);
+
+  unsigned char* const buffer = (unsigned char*)malloc((size_t)read_rows * read_bytes + 1);
+  int ierror = MPI_File_read(file, buffer, read_rows * read_bytes, MPI_BYTE,
+                             MPI_STATUS_IGNORE);
+
+  for (int r = rows[0]; r < rows[1]; r++) {
+    const unsigned char* const row = &buffer[(r - rows[0]) * read_bytes];
+    bool* const tile_row = &tile[(r - tile_offset[0] + game->halo) * cols_pad + game->halo];
+
+    for (int c = cols[0]; c < cols[1]; c++) {
+      const int bit = c - col_offset;
+      tile_row[c - tile_offset[1]] = (row[bit / 8 - byte_begin] >> (bit % 8)) & 1;
+    }
+  }
+
+  free(buffer);
+  if (overlap) {
+    MPI_Type_free(&file_type);
+  }
+  MPI_File_close(&file);
+
+  return ierror != MPI_SUCCESS;
+}
+
+int place_pattern(
+  GameInfo* const game, const Pattern* const pattern,
+  const int row_offset, const int col_offset)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  // Global rows and cols where the pattern overlaps this tile
+  const int rows[2] = {
+    max_int(tile_offset[0], row_offset),
+    min_int(tile_offset[0] + tile_size[0], row_offset + pattern->rows)
+  };
+  const int cols[2] = {
+    max_int(tile_offset[1], col_offset),
+    min_int(tile_offset[1] + tile_size[1], col_offset + pattern->cols)
+  };
+
+  bool* const tile = acquire_tile(game);
+  int ierror = 0;
+
+  if (pattern->format == PATTERN_PACKED) {
+    ierror = place_packed_pattern(game, pattern, tile, row_offset, col_offset,
+                                  rows, cols, tile_offset);
+  } else {
+    const int cols_pad = padded_cols(game);
+
+    for (int r = rows[0]; r < rows[1]; r++) {
+      for (int c = cols[0]; c < cols[1]; c++) {
+        tile[(r - tile_offset[0] + game->halo) * cols_pad + (c - tile_offset[1] + game->halo)] =
+          pattern->cells[(r - row_offset) * pattern->cols + (c - col_offset)];
+      }
+    }
+  }
+
+  release_tile(game, tile, true);
+
+  MPI_Allreduce(MPI_IN_PLACE, &ierror, 1, MPI_INT, MPI_MAX, game->communicator);
+  return ierror;
+}
+
+void close_pattern(Pattern* const pattern)
+{
+  free(pattern->cells);
+  pattern->cells = NULL;
+}
+
+void place_random(GameInfo* const game, const unsigned long seed)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  bool* const tile = acquire_tile(game);
+  const int cols_pad = padded_cols(game);
+  const uint64_t key = splitmix64(seed);
+
+  #pragma omp parallel for schedule(static)
+  for (int r = 0; r < tile_size[0]; r++) {
+    const uint64_t row = (uint64_t)(tile_offset[0] + r) * game->global_cols;
+    bool* const tile_row = &tile[(r + game->halo) * cols_pad + game->halo];
+
+    for (int c = 0; c < tile_size[1]; c++) {
+      tile_row[c] = splitmix64(key ^ (row + tile_offset[1] + c)) % 3 == 0;
+    }
+  }
+
+  release_tile(game, tile, true);
+}
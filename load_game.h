@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mpi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+
+enum PatternFormat {
+  PATTERN_RLE,      // run length encoded .rle
+  PATTERN_CELLS,    // plaintext .cells
+  PATTERN_PACKED    // raw packed bits, anything else
+};
+
+// Packed pattern files start with this header, followed by rows rows of
+// (cols + 7) / 8 bytes. Column c of a row is bit (c % 8) of byte (c / 8).
+struct PackedPatternHeader {
+  char magic[8];
+  int32_t version;
+  int32_t rows;
+  int32_t cols;
+  int32_t reserved;
+};
+
+// Text patterns are parsed by rank 0 and broadcast, as they are small
+// compared to the board. Packed patterns only have their header read here,
+// the cells are read by every rank in place_pattern().
+typedef struct Pattern {
+  enum PatternFormat format;
+  const char* path;
+  int rows;
+  int cols;
+
+  // rows x cols cells on every rank, text formats only
+  bool* cells;
+} Pattern;
+
+int open_pattern(Pattern* const pattern, const char* const path, const MPI_Comm communicator);
+
+// Place the pattern with its top left cell at the given global position,
+// cells outside the board are dropped. Must be called by all ranks.
+int place_pattern(
+  GameInfo* const game, const Pattern* const pattern,
+  const int row_offset, const int col_offset);
+
+void close_pattern(Pattern* const pattern);
+
+// Fill the board with about one third alive cells. Each cell only depends on
+// the seed and its global position, so every rank fills its own tile and the
+// board is the same for any number of ranks.
+void place_random(GameInfo* const game, const unsigned long seed);
@@ -2,64 +2,46 @@
 #include <stdio.h>
 #include <stdbool.h>
 
-#include "debug_game.h"
-#include "update_game.h"
-#include "initialize_game.h"
-#include "synchronize_game.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ensemble_game.h"
+#include "options_game.h"
+#include "run_game.h"
 
 int main(int argc, char* argv[])
 {
-  MPI_Init(&argc,&argv);
+  // Threads only compute, all MPI calls are made by the main thread
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
-  int rank, size;
+  int rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-  //
-  // Initialization
-  //
-  GameInfo game;
-
-  int rows = 0, cols = 0;
-  bool* init = NULL;
-
-  // rank 0 Loads data
-  if (rank == 0)  {
-    rows = 8;
-    cols = 8;
-    init = (bool[64]) {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 0, 0, 1, 1, 1,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 0, 0, 1, 1, 1,
-      0, 0, 0, 0, 0, 0, 0, 0
-    };
-  }
 
-  // refactored
-  if (initialize_game(&game, size, rank, rows, cols, init)) {
+  GameOptions options;
+  if (parse_options(&options, argc, argv, rank)) {
+    MPI_Finalize();
     return 1;
   }
 
-  //printf("[%d] local matrix (%d x %d):\n", rank, game.local_rows + 2, game.local_cols + 2);
-  //print_matrix(game.current, game.local_rows + 2, game.local_cols + 2);
-
-  // perform iterations
-  for (int iter = 0; iter < 5; iter++) {
-    synchronize_game(&game);
-
-    update_game(&game);
-
-    // Gather the full game on rank 0 and print
-    print_global_game(&game, rank);
+#ifdef _OPENMP
+  if (provided < MPI_THREAD_FUNNELED) {
+    if (rank == 0) fprintf(stderr, "MPI has no thread support, using one thread per rank\n");
+    options.threads = 1;
   }
+  if (options.threads > 0) {
+    omp_set_num_threads(options.threads);
+  }
+#endif
 
-  // Free buffers
-  destroy_game(&game);
+  int ierror;
+  if (options.ensemble_path) {
+    ierror = run_ensemble(&options, argc, argv, MPI_COMM_WORLD);
+  } else {
+    ierror = run_game(&options, MPI_COMM_WORLD, NULL);
+  }
 
   MPI_Finalize();
-  return 0;
+  return ierror;
 }
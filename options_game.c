@@ -0,0 +1,476 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+
+#include "options_game.h"
+#include "hashlife_game.h"
+#include "kernel_game.h"
+
+static inline void print_usage(const char* const program) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --storage=byte|packed  cell storage (default byte)\n"
+    "  --kernel=auto|scalar|avx2|avx512|neon\n"
+    "                         byte storage update kernel (default auto)\n"
+    "  --rule=RULE            B/S rule like B36/S23, Generations rules add /C<n>\n"
+    "                         states, or life|highlife|daynight|seeds|brain\n"
+    "  --exchange=derived|aggregated|persistent|neighborhood|rma|shared\n"
+    "                         byte storage halo exchange (default derived)\n"
+    "  --overlap              update interior cells while halos are in flight\n"
+    "  --sparse               only update blocks next to changed cells\n"
+    "  --halo=K               ghost cell width, exchange every K generations\n"
+    "  --threads=N            update threads per rank (default OMP_NUM_THREADS)\n"
+    "  --periodic             wrap the board around its edges (torus)\n"
+    "  --balance=N            rebalance the tiles every N generations\n"
+    "  --checkpoint=PATH      write a checkpoint at the end of the run\n"
+    "  --checkpoint-every=N   also write it every N generations\n"
+    "  --restart=PATH         continue from a checkpoint\n"
+    "  --pattern=PATH         initial pattern (.rle, .cells or packed bits)\n"
+    "  --size=ROWSxCOLS       board size (default fits the pattern), random\n"
+    "                         board without a pattern\n"
+    "  --offset=ROW,COL       pattern position on the board (default 0,0)\n"
+    "  --hashlife=N           jump N generations ahead with HashLife first\n"
+    "  --hashlife-memory=MB   HashLife node cache size (default 1024)\n"
+    "  --seed=N               random board seed (default 1)\n"
+    "  --generations=N        generations to run (default 5)\n"
+    "  --warmup=N             untimed generations before those (default 0)\n"
+    "  --detect=N             stop once the board died out or repeats, checked\n"
+    "                         every N generations\n"
+    "  --quiet                don't print the board\n"
+    "  --gather=flat|node     gather boards on rank 0 directly or through\n"
+    "                         node leaders (default flat)\n"
+    "  --snapshot=PREFIX      write PGM images PREFIX<generation>.pgm instead\n"
+    "                         of printing the board, implies --quiet\n"
+    "  --snapshot-every=N     generations between snapshots (default 1)\n"
+    "  --snapshot-scale=K     one pixel per KxK cells, gray by density\n"
+    "                         (default 1)\n"
+    "  --benchmark            report timings and cell updates per second,\n"
+    "                         implies --quiet\n"
+    "  --baseline=CUPS        single rank cell updates per second for the\n"
+    "                         parallel efficiency\n"
+    "  --trace=PREFIX         write per rank traces PREFIX<rank>.json of every\n"
+    "                         phase, halo wait and live cell count (builds\n"
+    "                         with make TRACE=1)\n"
+    "  --trace-format=chrome|csv\n"
+    "                         trace file format (default chrome)\n"
+    "  --ensemble=PATH        run the boards listed in PATH, one line of\n"
+    "                         options per board\n"
+    "  --ensemble-ranks=N     ranks per ensemble board (default 1)\n"
+    "  --help                 show this message\n",
+    program);
+}
+
+void default_options(GameOptions* const options) {
+  options->storage = GAME_STORAGE_BYTE;
+  options->kernel = GAME_KERNEL_AUTO;
+  options->rule = CONWAY_RULE;
+  options->exchange = GAME_EXCHANGE_DERIVED;
+  options->overlap = false;
+  options->sparse = false;
+  options->halo = 1;
+  options->threads = 0;
+  options->periodic = false;
+  options->balance = 0;
+  options->checkpoint_path = NULL;
+  options->checkpoint_every = 0;
+  options->restart_path = NULL;
+  options->pattern_path = NULL;
+  options->rows = 0;
+  options->cols = 0;
+  options->row_offset = 0;
+  options->col_offset = 0;
+  options->hashlife = 0;
+  options->hashlife_memory = (size_t)1024 << 20;
+  options->seed = 1;
+  options->generations = 5;
+  options->warmup = 0;
+  options->detect = 0;
+  options->quiet = false;
+  options->gather = GAME_GATHER_FLAT;
+  options->snapshot_path = NULL;
+  options->snapshot_every = 1;
+  options->snapshot_scale = 1;
+  options->benchmark = false;
+  options->baseline = 0.0;
+  options->trace_path = NULL;
+  options->trace_format = GAME_TRACE_CHROME;
+  options->ensemble_path = NULL;
+  options->ensemble_ranks = 1;
+}
+
+int parse_options(
+  GameOptions* const options,
+  int argc, char* argv[], const int rank)
+{
+  static const struct option long_options[] = {
+    {"storage",          required_argument, NULL, 's'},
+    {"kernel",           required_argument, NULL, 'k'},
+    {"rule",             required_argument, NULL, 'R'},
+    {"exchange",         required_argument, NULL, 'X'},
+    {"overlap",          no_argument,       NULL, 'o'},
+    {"sparse",           no_argument,       NULL, 'x'},
+    {"halo",             required_argument, NULL, 'g'},
+    {"threads",          required_argument, NULL, 't'},
+    {"periodic",         no_argument,       NULL, 'p'},
+    {"balance",          required_argument, NULL, 'L'},
+    {"checkpoint",       required_argument, NULL, 'c'},
+    {"checkpoint-every", required_argument, NULL, 'C'},
+    {"restart",          required_argument, NULL, 'r'},
+    {"pattern",          required_argument, NULL, 'P'},
+    {"size",             required_argument, NULL, 'S'},
+    {"offset",           required_argument, NULL, 'O'},
+    {"hashlife",         required_argument, NULL, 'H'},
+    {"hashlife-memory",  required_argument, NULL, 'M'},
+    {"seed",             required_argument, NULL, 'e'},
+    {"generations",      required_argument, NULL, 'n'},
+    {"warmup",           required_argument, NULL, 'w'},
+    {"detect",           required_argument, NULL, 'D'},
+    {"quiet",            no_argument,       NULL, 'q'},
+    {"gather",           required_argument, NULL, 'A'},
+    {"snapshot",         required_argument, NULL, 'i'},
+    {"snapshot-every",   required_argument, NULL, 'I'},
+    {"snapshot-scale",   required_argument, NULL, 'K'},
+    {"benchmark",        no_argument,       NULL, 'b'},
+    {"baseline",         required_argument, NULL, 'B'},
+    {"trace",            required_argument, NULL, 'T'},
+    {"trace-format",     required_argument, NULL, 'F'},
+    {"ensemble",         required_argument, NULL, 'E'},
+    {"ensemble-ranks",   required_argument, NULL, 'G'},
+    {"help",             no_argument,       NULL, 'h'},
+    {NULL,               0,                 NULL,   0}
+  };
+
+  default_options(options);
+
+  // Only rank 0 reports problems, all ranks parse the same argv. Ensembles
+  // parse once per board, which needs a full reset of getopt.
+  opterr = 0;
+  optind = 0;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        if (strcmp(optarg, "byte") == 0) {
+          options->storage = GAME_STORAGE_BYTE;
+        } else if (strcmp(optarg, "packed") == 0) {
+          options->storage = GAME_STORAGE_PACKED;
+        } else {
+          if (rank == 0) fprintf(stderr, "unknown storage: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'k':
+        if (strcmp(optarg, "auto") == 0) {
+          options->kernel = GAME_KERNEL_AUTO;
+        } else if (strcmp(optarg, "scalar") == 0) {
+          options->kernel = GAME_KERNEL_SCALAR;
+        } else if (strcmp(optarg, "avx2") == 0) {
+          options->kernel = GAME_KERNEL_AVX2;
+        } else if (strcmp(optarg, "avx512") == 0) {
+          options->kernel = GAME_KERNEL_AVX512;
+        } else if (strcmp(optarg, "neon") == 0) {
+          options->kernel = GAME_KERNEL_NEON;
+        } else {
+          if (rank == 0) fprintf(stderr, "unknown kernel: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'R':
+        if (parse_rule(&options->rule, optarg)) {
+          if (rank == 0) fprintf(stderr, "invalid rule: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'X':
+        if (strcmp(optarg, "derived") == 0) {
+          options->exchange = GAME_EXCHANGE_DERIVED;
+        } else if (strcmp(optarg, "aggregated") == 0) {
+          options->exchange = GAME_EXCHANGE_AGGREGATED;
+        } else if (strcmp(optarg, "persistent") == 0) {
+          options->exchange = GAME_EXCHANGE_PERSISTENT;
+        } else if (strcmp(optarg, "neighborhood") == 0) {
+          options->exchange = GAME_EXCHANGE_NEIGHBORHOOD;
+        } else if (strcmp(optarg, "rma") == 0) {
+          options->exchange = GAME_EXCHANGE_RMA;
+        } else if (strcmp(optarg, "shared") == 0) {
+          options->exchange = GAME_EXCHANGE_SHARED;
+        } else {
+          if (rank == 0) fprintf(stderr, "unknown exchange: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'o':
+        options->overlap = true;
+        break;
+
+      case 'x':
+        options->sparse = true;
+        break;
+
+      case 'g':
+        options->halo = atoi(optarg);
+        if (options->halo < 1) {
+          if (rank == 0) fprintf(stderr, "halo width must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 't':
+        options->threads = atoi(optarg);
+        if (options->threads < 1) {
+          if (rank == 0) fprintf(stderr, "thread count must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'p':
+        options->periodic = true;
+        break;
+
+      case 'L':
+        options->balance = atoi(optarg);
+        if (options->balance < 1) {
+          if (rank == 0) fprintf(stderr, "balance interval must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'c':
+        options->checkpoint_path = optarg;
+        break;
+
+      case 'C':
+        options->checkpoint_every = atoi(optarg);
+        if (options->checkpoint_every < 1) {
+          if (rank == 0) fprintf(stderr, "checkpoint interval must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'r':
+        options->restart_path = optarg;
+        break;
+
+      case 'P':
+        options->pattern_path = optarg;
+        break;
+
+      case 'S':
+        if (sscanf(optarg, "%dx%d", &options->rows, &options->cols) != 2 ||
+            options->rows < 1 || options->cols < 1) {
+          if (rank == 0) fprintf(stderr, "invalid board size: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'O':
+        if (sscanf(optarg, "%d,%d", &options->row_offset, &options->col_offset) != 2 ||
+            options->row_offset < 0 || options->col_offset < 0) {
+          if (rank == 0) fprintf(stderr, "invalid pattern offset: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'H': {
+        // strtoull would wrap negative numbers around
+        char* end;
+        options->hashlife = strtoull(optarg, &end, 10);
+        if (end == optarg || *end != '\0' || strchr(optarg, '-') != NULL) {
+          if (rank == 0) fprintf(stderr, "invalid HashLife generations: %s\n", optarg);
+          return 1;
+        }
+        break;
+      }
+
+      case 'M': {
+        char* end;
+        const long megabytes = strtol(optarg, &end, 10);
+        if (end == optarg || *end != '\0' || megabytes < 1) {
+          if (rank == 0) fprintf(stderr, "HashLife memory must be positive: %s\n", optarg);
+          return 1;
+        }
+        if ((unsigned long)megabytes > (SIZE_MAX >> 20)) {
+          if (rank == 0) fprintf(stderr, "HashLife memory too large: %s\n", optarg);
+          return 1;
+        }
+        options->hashlife_memory = (size_t)megabytes << 20;
+        break;
+      }
+
+      case 'e':
+        options->seed = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'n':
+        options->generations = atoi(optarg);
+        if (options->generations < 0) {
+          if (rank == 0) fprintf(stderr, "generation count must not be negative: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'w':
+        options->warmup = atoi(optarg);
+        if (options->warmup < 0) {
+          if (rank == 0) fprintf(stderr, "warmup count must not be negative: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'D':
+        options->detect = atoi(optarg);
+        if (options->detect < 1) {
+          if (rank == 0) fprintf(stderr, "detection interval must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'q':
+        options->quiet = true;
+        break;
+
+      case 'A':
+        if (strcmp(optarg, "flat") == 0) {
+          options->gather = GAME_GATHER_FLAT;
+        } else if (strcmp(optarg, "node") == 0) {
+          options->gather = GAME_GATHER_NODE;
+        } else {
+          if (rank == 0) fprintf(stderr, "unknown gather: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'i':
+        options->snapshot_path = optarg;
+        options->quiet = true;
+        break;
+
+      case 'I':
+        options->snapshot_every = atoi(optarg);
+        if (options->snapshot_every < 1) {
+          if (rank == 0) fprintf(stderr, "snapshot interval must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'K':
+        options->snapshot_scale = atoi(optarg);
+        if (options->snapshot_scale < 1 || options->snapshot_scale > 65535) {
+          if (rank == 0) fprintf(stderr, "snapshot scale must be between 1 and 65535: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'b':
+        options->benchmark = true;
+        options->quiet = true;
+        break;
+
+      case 'B':
+        options->baseline = atof(optarg);
+        break;
+
+      case 'T':
+        options->trace_path = optarg;
+        break;
+
+      case 'F':
+        if (strcmp(optarg, "chrome") == 0) {
+          options->trace_format = GAME_TRACE_CHROME;
+        } else if (strcmp(optarg, "csv") == 0) {
+          options->trace_format = GAME_TRACE_CSV;
+        } else {
+          if (rank == 0) fprintf(stderr, "unknown trace format: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'E':
+        options->ensemble_path = optarg;
+        break;
+
+      case 'G':
+        options->ensemble_ranks = atoi(optarg);
+        if (options->ensemble_ranks < 1) {
+          if (rank == 0) fprintf(stderr, "ensemble ranks must be positive: %s\n", optarg);
+          return 1;
+        }
+        break;
+
+      case 'h':
+      default:
+        if (rank == 0) print_usage(argv[0]);
+        return 1;
+    }
+  }
+
+  // Deep halos are only implemented for the plain byte exchange
+  if (options->halo > 1 && (options->storage == GAME_STORAGE_PACKED || options->overlap)) {
+    if (rank == 0) fprintf(stderr, "--halo above 1 requires byte storage without --overlap\n");
+    return 1;
+  }
+
+  // The change map tracks one generation between exchanges of byte tiles
+  if (options->sparse && (options->storage == GAME_STORAGE_PACKED || options->overlap ||
+                          options->halo > 1 || options->exchange != GAME_EXCHANGE_DERIVED)) {
+    if (rank == 0) fprintf(stderr, "--sparse requires byte storage and the derived exchange without --overlap and --halo\n");
+    return 1;
+  }
+
+  // A jump of 2^n generations needs a universe of level n + 3 at least
+  if (options->hashlife >= (1ull << (HASHLIFE_MAX_LEVEL - 3))) {
+    if (rank == 0) fprintf(stderr, "HashLife jumps must be shorter than 2^%d generations\n",
+                           HASHLIFE_MAX_LEVEL - 3);
+    return 1;
+  }
+
+  // HashLife runs on the plane, it has no notion of a torus
+  if (options->hashlife > 0 && options->periodic) {
+    if (rank == 0) fprintf(stderr, "--hashlife can't be combined with --periodic\n");
+    return 1;
+  }
+
+  // Dead cells outside the board would come alive
+  if (options->rule.birth & 1) {
+    if (rank == 0) fprintf(stderr, "rules with B0 are not supported\n");
+    return 1;
+  }
+
+  // The dying states only live in the byte tiles, and only the stencil
+  // updates them
+  if (options->rule.states > 2 &&
+      (options->storage == GAME_STORAGE_PACKED || options->halo > 1 || options->sparse ||
+       options->balance > 0 || options->hashlife > 0)) {
+    if (rank == 0) fprintf(stderr, "Generations rules require byte storage without --halo, --sparse, --balance and --hashlife\n");
+    return 1;
+  }
+
+  // Packed storage has kernels for the named life-like rules only
+  if (options->storage == GAME_STORAGE_PACKED && select_packed_kernel(&options->rule) == NULL) {
+    if (rank == 0) fprintf(stderr, "packed storage supports the rules life, highlife, daynight and seeds\n");
+    return 1;
+  }
+
+#ifndef GAME_TRACE
+  // The instrumentation is compiled out of default builds
+  if (options->trace_path) {
+    if (rank == 0) fprintf(stderr, "--trace requires a build with make TRACE=1\n");
+    return 1;
+  }
+#endif
+
+  if (options->pattern_path && options->restart_path) {
+    if (rank == 0) fprintf(stderr, "--pattern and --restart are exclusive\n");
+    return 1;
+  }
+
+  return 0;
+}
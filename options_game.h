@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "rule_game.h"
+
+enum GameStorage {
+  GAME_STORAGE_BYTE,   // one bool per cell
+  GAME_STORAGE_PACKED  // 64 cells per uint64_t word, see packed_game.h
+};
+
+enum GameKernelType {
+  GAME_KERNEL_AUTO,    // widest vector kernel supported by the CPU
+  GAME_KERNEL_SCALAR,
+  GAME_KERNEL_AVX2,
+  GAME_KERNEL_AVX512,
+  GAME_KERNEL_NEON
+};
+
+enum GameExchange {
+  GAME_EXCHANGE_DERIVED,       // 16 messages with subarray datatypes
+  GAME_EXCHANGE_AGGREGATED,    // columns packed by hand, then full rows
+  GAME_EXCHANGE_PERSISTENT,    // derived, with persistent requests
+  GAME_EXCHANGE_NEIGHBORHOOD,  // derived, as one neighborhood collective
+  GAME_EXCHANGE_RMA,           // MPI_Put into the neighbours windows
+  GAME_EXCHANGE_SHARED         // shared memory within a node, derived between
+};
+
+enum GameGather {
+  GAME_GATHER_FLAT,  // every rank sends its tile to rank 0
+  GAME_GATHER_NODE   // node leaders collect the tiles of their node first
+};
+
+enum GameTraceFormat {
+  GAME_TRACE_CHROME,  // Chrome trace event JSON
+  GAME_TRACE_CSV
+};
+
+typedef struct GameOptions {
+  // cell storage used by the update kernel and the halo exchange
+  enum GameStorage storage;
+
+  // update kernel for byte storage, see kernel_game.h
+  enum GameKernelType kernel;
+
+  // rule of the game, B3/S23 by default
+  GameRule rule;
+
+  // halo exchange for byte storage, packed storage always aggregates
+  enum GameExchange exchange;
+
+  // overlap the halo exchange with the update of the interior cells
+  bool overlap;
+
+  // only update the blocks of the tile next to cells that changed
+  bool sparse;
+
+  // ghost cell width, halos are exchanged every halo generations
+  int halo;
+
+  // threads per rank for the update, zero leaves it to OMP_NUM_THREADS
+  int threads;
+
+  // wrap the board around its edges
+  bool periodic;
+
+  // move the tile boundaries by the measured update time of each rank every
+  // balance generations (if positive)
+  int balance;
+
+  // checkpoint file written at the end and every checkpoint_every
+  // generations (if positive), and checkpoint file to restart from
+  const char* checkpoint_path;
+  int checkpoint_every;
+  const char* restart_path;
+
+  // initial pattern file, see load_game.h, placed with its top left cell
+  // at (row_offset, col_offset) on a rows x cols board. A zero size fits
+  // the board to the pattern and its offset, a size without a pattern
+  // gives a random board.
+  const char* pattern_path;
+  int rows;
+  int cols;
+  int row_offset;
+  int col_offset;
+
+  // generations to jump ahead with HashLife before the stencil takes over,
+  // and the memory cap of its node cache in bytes
+  unsigned long long hashlife;
+  size_t hashlife_memory;
+
+  // seed of the random board used when --size is given without a pattern
+  unsigned long seed;
+
+  // generations to run, after warmup untimed ones
+  int generations;
+  int warmup;
+
+  // stop once the board died out or repeats, checked over all ranks every
+  // detect generations (if positive)
+  int detect;
+
+  // don't print the board every generation
+  bool quiet;
+
+  // how printed boards and HashLife jumps gather the tiles on rank 0
+  enum GameGather gather;
+
+  // PGM snapshots PREFIX<generation>.pgm written every snapshot_every
+  // generations, one pixel per snapshot_scale x snapshot_scale cells, see
+  // snapshot_game.h
+  const char* snapshot_path;
+  int snapshot_every;
+  int snapshot_scale;
+
+  // report timings at the end, see benchmark_game.h, with the cell updates
+  // per second of a single rank as the baseline for the efficiency
+  bool benchmark;
+  double baseline;
+
+  // per rank trace files PREFIX<rank>.json or .csv, only in builds with
+  // GAME_TRACE, see trace_game.h
+  const char* trace_path;
+  enum GameTraceFormat trace_format;
+
+  // file of boards to run side by side, see ensemble_game.h, and the ranks
+  // that run each of them
+  const char* ensemble_path;
+  int ensemble_ranks;
+} GameOptions;
+
+void default_options(GameOptions* const options);
+
+int parse_options(
+  GameOptions* const options,
+  int argc, char* argv[], const int rank);
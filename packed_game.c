@@ -0,0 +1,64 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "packed_game.h"
+
+void pack_tile(
+  const bool* restrict const tile, uint64_t* restrict const packed,
+  const int local_rows, const int local_cols)
+{
+  const int cols_pad = local_cols + 2;
+  const int words = packed_words_per_row(local_cols);
+
+  memset(packed, 0, (local_rows + 2) * words * sizeof(uint64_t));
+
+  for (int r = 0; r < local_rows + 2; r++) {
+    for (int c = 0; c < cols_pad; c++) {
+      if (tile[r * cols_pad + c]) {
+        packed_set(&packed[r * words], c, 1);
+      }
+    }
+  }
+}
+
+void unpack_tile(
+  const uint64_t* restrict const packed, bool* restrict const tile,
+  const int local_rows, const int local_cols)
+{
+  const int cols_pad = local_cols + 2;
+  const int words = packed_words_per_row(local_cols);
+
+  for (int r = 0; r < local_rows + 2; r++) {
+    for (int c = 0; c < cols_pad; c++) {
+      tile[r * cols_pad + c] = packed_get(&packed[r * words], c);
+    }
+  }
+}
+
+void pack_column(
+  const uint64_t* restrict const packed, uint64_t* restrict const buffer,
+  const int col, const int local_rows, const int local_cols)
+{
+  const int words = packed_words_per_row(local_cols);
+
+  memset(buffer, 0, packed_column_words(local_rows) * sizeof(uint64_t));
+
+  for (int r = 1; r < local_rows + 1; r++) {
+    if (packed_get(&packed[r * words], col)) {
+      packed_set(buffer, r - 1, 1);
+    }
+  }
+}
+
+void unpack_column(
+  const uint64_t* restrict const buffer, uint64_t* restrict const packed,
+  const int col, const int local_rows, const int local_cols)
+{
+  const int words = packed_words_per_row(local_cols);
+
+  for (int r = 1; r < local_rows + 1; r++) {
+    packed_set(&packed[r * words], col, packed_get(buffer, r - 1));
+  }
+}
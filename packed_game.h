@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Packed tiles hold the same padded (local_rows + 2) x (local_cols + 2) game
+// as the byte tiles, but with 64 cells per word. Padded column c of a row is
+// bit (c % 64) of word (c / 64), so the west halo is bit 0 of the first word.
+// Bits past column local_cols + 1 are padding and always zero.
+#define PACKED_WORD_BITS 64
+
+static inline int packed_words_per_row(const int local_cols) {
+  return (local_cols + 2 + PACKED_WORD_BITS - 1) / PACKED_WORD_BITS;
+}
+
+static inline int packed_column_words(const int local_rows) {
+  return (local_rows + PACKED_WORD_BITS - 1) / PACKED_WORD_BITS;
+}
+
+static inline bool packed_get(
+  const uint64_t* restrict const row, const int col)
+{
+  return (row[col / PACKED_WORD_BITS] >> (col % PACKED_WORD_BITS)) & 1;
+}
+
+static inline void packed_set(
+  uint64_t* restrict const row, const int col, const bool value)
+{
+  const uint64_t bit = (uint64_t)1 << (col % PACKED_WORD_BITS);
+  if (value) {
+    row[col / PACKED_WORD_BITS] |= bit;
+  } else {
+    row[col / PACKED_WORD_BITS] &= ~bit;
+  }
+}
+
+// Convert full padded tiles between the byte and packed layout
+void pack_tile(
+  const bool* restrict const tile, uint64_t* restrict const packed,
+  const int local_rows, const int local_cols);
+void unpack_tile(
+  const uint64_t* restrict const packed, bool* restrict const tile,
+  const int local_rows, const int local_cols);
+
+// Copy padded column col of rows 1 .. local_rows into/from a contiguous bit
+// buffer of packed_column_words(local_rows) words, used for east/west halos
+void pack_column(
+  const uint64_t* restrict const packed, uint64_t* restrict const buffer,
+  const int col, const int local_rows, const int local_cols);
+void unpack_column(
+  const uint64_t* restrict const buffer, uint64_t* restrict const packed,
+  const int col, const int local_rows, const int local_cols);
@@ -0,0 +1,84 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "rule_game.h"
+
+static const struct {
+  const char* name;
+  const char* rule;
+} RULE_NAMES[] = {
+  {"life",     "B3/S23"},
+  {"highlife", "B36/S23"},
+  {"daynight", "B3678/S34678"},
+  {"seeds",    "B2/S"},
+  {"brain",    "B2/S/C3"}
+};
+
+// Neighbour counts 0 to 8 as a bit set, the digits end at the next '/'
+static inline int parse_counts(const char* text, uint16_t* const counts)
+{
+  *counts = 0;
+  for (; *text != '\0' && *text != '/'; text++) {
+    if (*text < '0' || *text > '8') {
+      return 1;
+    }
+    *counts |= 1 << (*text - '0');
+  }
+  return 0;
+}
+
+int parse_rule(GameRule* const rule, const char* const text)
+{
+  for (size_t i = 0; i < sizeof(RULE_NAMES) / sizeof(RULE_NAMES[0]); i++) {
+    if (strcasecmp(text, RULE_NAMES[i].name) == 0) {
+      return parse_rule(rule, RULE_NAMES[i].rule);
+    }
+  }
+
+  rule->birth = 0;
+  rule->survive = 0;
+  rule->states = 2;
+
+  bool has_birth = false, has_survive = false, has_states = false;
+
+  for (const char* part = text; ; part++) {
+    const char kind = toupper((unsigned char)*part);
+
+    if (kind == 'B' && !has_birth) {
+      has_birth = true;
+      if (parse_counts(part + 1, &rule->birth)) return 1;
+    } else if (kind == 'S' && !has_survive) {
+      has_survive = true;
+      if (parse_counts(part + 1, &rule->survive)) return 1;
+    } else if ((kind == 'C' || kind == 'G') && !has_states) {
+      has_states = true;
+      char* end;
+      rule->states = strtol(part + 1, &end, 10);
+      if (end == part + 1 || (*end != '\0' && *end != '/')) return 1;
+    } else {
+      return 1;
+    }
+
+    part = strchr(part, '/');
+    if (part == NULL) {
+      break;
+    }
+  }
+
+  if (!has_birth || !has_survive || rule->states < 2 || rule->states > RULE_MAX_STATES) {
+    return 1;
+  }
+
+  return 0;
+}
+
+void rule_table(const GameRule* const rule, uint8_t* restrict const table)
+{
+  memset(table, 0, RULE_TABLE_SIZE);
+  for (int n = 0; n <= 8; n++) {
+    table[n] = (rule->birth >> n) & 1;
+    table[RULE_TABLE_ALIVE + n] = (rule->survive >> n) & 1;
+  }
+}
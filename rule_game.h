@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Life-like rules in B/S notation, e.g. B36/S23 for HighLife: bit n of birth
+// is set if a dead cell with n live neighbours comes alive, bit n of survive
+// if a live cell with n live neighbours stays alive. Generations rules add a
+// state count, B2/S/C3 is Brian's Brain. A cell that dies there goes through
+// states - 2 dying states before it is dead, and can't be born meanwhile.
+// Only live cells count as neighbours.
+typedef struct GameRule {
+  uint16_t birth;
+  uint16_t survive;
+  int states;
+} GameRule;
+
+#define RULE_MAX_STATES 256
+
+// Lookup table of the next cell, indexed by alive * RULE_TABLE_ALIVE plus the
+// live neighbour count. Each half is 16 entries, so the vector kernels can
+// look it up with a single byte shuffle.
+#define RULE_TABLE_ALIVE 16
+#define RULE_TABLE_SIZE (2 * RULE_TABLE_ALIVE)
+
+static const GameRule CONWAY_RULE = {1 << 3, (1 << 2) | (1 << 3), 2};
+
+static inline bool is_conway_rule(const GameRule* const rule)
+{
+  return rule->birth == CONWAY_RULE.birth && rule->survive == CONWAY_RULE.survive;
+}
+
+// Parse B/S notation, optionally followed by /C<states>, or one of the names
+// life, highlife, daynight, seeds and brain. The B and S parts may come in
+// either order. Returns 1 on a malformed rule.
+int parse_rule(GameRule* const rule, const char* const text);
+
+void rule_table(const GameRule* const rule, uint8_t* restrict const table);
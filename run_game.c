@@ -0,0 +1,296 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "load_game.h"
+#include "benchmark_game.h"
+#include "cycle_game.h"
+#include "hashlife_game.h"
+#include "balance_game.h"
+#include "debug_game.h"
+#include "checkpoint_game.h"
+#include "snapshot_game.h"
+#include "options_game.h"
+#include "update_game.h"
+#include "initialize_game.h"
+#include "synchronize_game.h"
+#include "run_game.h"
+#include "trace_game.h"
+
+static inline void write_game_checkpoint(
+  GameInfo* const game, const char* const path, const long generation, const int rank)
+{
+  if (write_checkpoint(game, path, generation)) {
+    if (rank == 0) fprintf(stderr, "can't write checkpoint %s\n", path);
+  }
+}
+
+// Snapshots are written while the next generations run, so a failed write
+// only shows when it is finished
+static inline void finish_game_snapshot(SnapshotWriter* const writer, const int rank)
+{
+  const long generation = writer->generation;
+  if (finish_snapshot(writer)) {
+    if (rank == 0) fprintf(stderr, "can't write snapshot of generation %ld\n", generation);
+  }
+}
+
+static inline void start_game_snapshot(
+  SnapshotWriter* const writer, GameInfo* const game, const long generation, const int rank)
+{
+  finish_game_snapshot(writer, rank);
+  if (start_snapshot(writer, game, generation)) {
+    if (rank == 0) fprintf(stderr, "can't write snapshot of generation %ld\n", generation);
+  }
+}
+
+int run_game(const GameOptions* const options, const MPI_Comm parent, GameResult* const result)
+{
+  int rank;
+  MPI_Comm_rank(parent, &rank);
+
+  //
+  // Initialization
+  //
+  GameInfo game;
+
+  // Built-in board, kept outside of the block that assigns init so it stays
+  // alive until the scatter
+  static bool initial_board[64] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 0, 0, 1, 1, 1,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 0, 0, 1, 1, 1,
+    0, 0, 0, 0, 0, 0, 0, 0
+  };
+
+  int rows = 0, cols = 0;
+  bool* init = NULL;
+  long generation = 0;
+  Pattern pattern;
+
+  // Restarts take the board size from the checkpoint, the cells are read
+  // in parallel once the game is initialized
+  if (options->restart_path) {
+    struct CheckpointHeader header;
+    if (read_checkpoint_header(options->restart_path, &header, &options->rule, parent)) {
+      if (rank == 0) fprintf(stderr, "can't read checkpoint %s, or it has other states than the rule\n",
+                             options->restart_path);
+      return 1;
+    }
+
+    rows = header.rows;
+    cols = header.cols;
+    generation = header.generation;
+  }
+  // Patterns are placed by every rank into its own tile
+  else if (options->pattern_path) {
+    if (open_pattern(&pattern, options->pattern_path, parent)) {
+      if (rank == 0) fprintf(stderr, "can't read pattern %s\n", options->pattern_path);
+      return 1;
+    }
+
+    rows = options->rows > 0 ? options->rows : options->row_offset + pattern.rows;
+    cols = options->cols > 0 ? options->cols : options->col_offset + pattern.cols;
+  }
+  // Random board, every rank fills its own tile
+  else if (options->rows > 0) {
+    rows = options->rows;
+    cols = options->cols;
+  }
+  // rank 0 Loads data
+  else if (rank == 0)  {
+    rows = 8;
+    cols = 8;
+    init = initial_board;
+  }
+
+  // refactored
+  if (initialize_game(&game, parent, rows, cols, init, options)) {
+    if (options->pattern_path) {
+      close_pattern(&pattern);
+    }
+    return 1;
+  }
+
+  if (options->restart_path && read_checkpoint(&game, options->restart_path)) {
+    if (rank == 0) fprintf(stderr, "can't read checkpoint %s\n", options->restart_path);
+    destroy_game(&game);
+    if (options->pattern_path) {
+      close_pattern(&pattern);
+    }
+    return 1;
+  }
+
+  if (options->pattern_path) {
+    if (place_pattern(&game, &pattern, options->row_offset, options->col_offset)) {
+      if (rank == 0) fprintf(stderr, "can't read pattern %s\n", options->pattern_path);
+      destroy_game(&game);
+      close_pattern(&pattern);
+      return 1;
+    }
+    close_pattern(&pattern);
+  }
+  else if (!options->restart_path && options->rows > 0) {
+    place_random(&game, options->seed);
+  }
+
+  //printf("[%d] local matrix (%d x %d):\n", rank, game.local_rows + 2, game.local_cols + 2);
+  //print_matrix(game.current, game.local_rows + 2, game.local_cols + 2);
+
+  // Jump ahead, the stencil continues from there
+  if (options->hashlife > 0) {
+    if (jump_game(&game, options->hashlife, options->hashlife_memory)) {
+      destroy_game(&game);
+      return 1;
+    }
+    generation += options->hashlife;
+  }
+
+  // perform iterations, the warmup generations are not timed
+  GameTimer timer;
+  reset_timer(&timer);
+
+  // update time since the last rebalancing
+  double balance_load = 0.0;
+
+  // Stop early once the board died out or repeats, starting from the board
+  // as it is now
+  CycleDetector detector;
+  if (options->detect > 0) {
+    initialize_cycle_detector(&detector, &game, options->detect);
+    detect_cycle(&detector, &game, generation);
+  }
+  bool settled = false;
+  long timed_generations = 0;
+
+  SnapshotWriter snapshots;
+  initialize_snapshot_writer(&snapshots, options->snapshot_path, options->snapshot_scale);
+
+  TRACE_START(options, &game);
+
+  for (int iter = 0; iter < options->warmup + options->generations && !settled; iter++) {
+    if (iter >= options->warmup) {
+      timed_generations++;
+    }
+    if (iter == options->warmup) {
+      MPI_Barrier(game.communicator);
+      reset_timer(&timer);
+    }
+    TRACE_GENERATION(generation + 1);
+
+    const double update_before = timer.phase[PHASE_UPDATE];
+    double start = MPI_Wtime();
+
+    if (options->overlap) {
+      // Hide the halo exchange behind the cells that don't need it
+      start_synchronize_game(&game);
+      start = add_phase_time(&timer, PHASE_SYNCHRONIZE, start);
+      update_game_interior(&game);
+      start = add_phase_time(&timer, PHASE_UPDATE, start);
+      finish_synchronize_game(&game);
+      start = add_phase_time(&timer, PHASE_SYNCHRONIZE, start);
+      update_game_border(&game);
+      start = add_phase_time(&timer, PHASE_UPDATE, start);
+    } else {
+      // Deep halos are only exchanged every halo generations
+      if (halo_expired(&game)) {
+        synchronize_game(&game);
+        start = add_phase_time(&timer, PHASE_SYNCHRONIZE, start);
+      }
+
+      update_game(&game);
+      start = add_phase_time(&timer, PHASE_UPDATE, start);
+    }
+
+    generation++;
+
+    balance_load += timer.phase[PHASE_UPDATE] - update_before;
+    if (options->balance > 0 && generation % options->balance == 0) {
+      balance_game(&game, balance_load);
+      balance_load = 0.0;
+      start = add_phase_time(&timer, PHASE_BALANCE, start);
+    }
+
+    // Gather the full game on rank 0 and print
+    if (!options->quiet) {
+      print_global_game(&game, game.rank);
+    }
+
+    if (options->snapshot_path && generation % options->snapshot_every == 0) {
+      start_game_snapshot(&snapshots, &game, generation, rank);
+    }
+
+    if (options->checkpoint_path && options->checkpoint_every > 0 &&
+        generation % options->checkpoint_every == 0) {
+      write_game_checkpoint(&game, options->checkpoint_path, generation, rank);
+    }
+
+    start = add_phase_time(&timer, PHASE_IO, start);
+
+    if (options->detect > 0) {
+      settled = detect_cycle(&detector, &game, generation);
+      add_phase_time(&timer, PHASE_DETECT, start);
+    }
+
+    TRACE_POPULATION(&game);
+  }
+
+  // The last snapshot still counts as I/O of the run
+  const double snapshot_start = MPI_Wtime();
+  finish_game_snapshot(&snapshots, rank);
+  add_phase_time(&timer, PHASE_IO, snapshot_start);
+  stop_timer(&timer);
+
+  if (TRACE_FINISH()) {
+    fprintf(stderr, "can't write the trace of rank %d\n", game.rank);
+  }
+
+  // Ensembles report it in their summary
+  if (settled && result == NULL && rank == 0) {
+    if (detector.extinct) {
+      printf("board died out in generation %ld\n", detector.settled);
+    } else if (detector.period == 1) {
+      printf("board is still since generation %ld\n", detector.settled);
+    } else {
+      printf("board repeats with period %d since generation %ld\n",
+             detector.period, detector.settled);
+    }
+  }
+
+  if (options->benchmark) {
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+    report_benchmark(&timer, &game, timed_generations, threads, options->baseline);
+  }
+
+  if (options->checkpoint_path) {
+    write_game_checkpoint(&game, options->checkpoint_path, generation, rank);
+  }
+
+  if (result != NULL) {
+    result->generation = generation;
+    result->population = count_population(&game);
+    result->settled = settled ? detector.settled : -1;
+    result->period = settled ? detector.period : 0;
+  }
+
+  if (options->detect > 0) {
+    destroy_cycle_detector(&detector);
+  }
+
+  // Free buffers
+  destroy_game(&game);
+
+  return 0;
+}
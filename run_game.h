@@ -0,0 +1,19 @@
+#pragma once
+
+#include <mpi.h>
+
+#include "options_game.h"
+
+// Where a run ended, for the summary of an ensemble. With --detect, settled
+// is the generation from which the board repeats with period, or -1.
+typedef struct GameResult {
+  long generation;
+  unsigned long long population;
+  long settled;
+  int period;
+} GameResult;
+
+// Set up the game described by options on the ranks of parent, run it and
+// write its checkpoint. Fills result if not NULL. Returns nonzero if the
+// board couldn't be set up, I/O errors during the run abort.
+int run_game(const GameOptions* const options, const MPI_Comm parent, GameResult* const result);
@@ -0,0 +1,290 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "initialize_game.h"
+#include "snapshot_game.h"
+
+static const int SNAPSHOT_TAG = 22;
+
+static inline int ceil_div(const int a, const int b) {
+  return (a + b - 1) / b;
+}
+
+static inline int min_int(const int a, const int b) {
+  return a < b ? a : b;
+}
+
+static inline int max_int(const int a, const int b) {
+  return a > b ? a : b;
+}
+
+// Pixels of one dimension that the cells [start, stop) overlap, from first
+// to end, and the ones whose first cell is among them, from owned to end
+typedef struct PixelRange {
+  int first;
+  int owned;
+  int end;
+} PixelRange;
+
+static inline PixelRange pixel_range(const int start, const int stop, const int scale) {
+  PixelRange range = {start / scale, ceil_div(start, scale), ceil_div(stop, scale)};
+  return range;
+}
+
+// Process rows (or cols) whose tiles overlap the cells [begin, end)
+static inline void overlapping_parts(
+  const int* restrict const start, const int parts, const int begin, const int end,
+  int* restrict const first, int* restrict const last)
+{
+  *first = 0;
+  while (*first < parts - 1 && start[*first + 1] <= begin) {
+    (*first)++;
+  }
+  *last = *first;
+  while (*last < parts && start[*last] < end) {
+    (*last)++;
+  }
+}
+
+void initialize_snapshot_writer(
+  SnapshotWriter* const writer, const char* const prefix, const int scale)
+{
+  writer->prefix = prefix;
+  writer->scale = scale;
+  writer->pending = false;
+  writer->generation = 0;
+  writer->image = NULL;
+}
+
+// Live cells of the tile in every pixel it overlaps. Threads split the
+// pixel rows, and the cells of a pixel row are summed up one contiguous run
+// per pixel.
+static void count_pixels(
+  const GameInfo* const game, const bool* restrict const tile, const int scale,
+  const PixelRange range[2], uint32_t* restrict const counts)
+{
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  const int cols_pad = padded_cols(game);
+  const int width = range[1].end - range[1].first;
+
+  #pragma omp parallel for schedule(static)
+  for (int p = range[0].first; p < range[0].end; p++) {
+    const int row_begin = max_int(p * scale, tile_offset[0]) - tile_offset[0];
+    const int row_end = min_int((p + 1) * scale, tile_offset[0] + tile_size[0]) - tile_offset[0];
+    uint32_t* const row_counts = &counts[(p - range[0].first) * width];
+
+    for (int r = row_begin; r < row_end; r++) {
+      const bool* const cells = &tile[(r + game->halo) * cols_pad + game->halo];
+
+      for (int q = range[1].first; q < range[1].end; q++) {
+        const int col_begin = max_int(q * scale, tile_offset[1]) - tile_offset[1];
+        const int col_end = min_int((q + 1) * scale, tile_offset[1] + tile_size[1]) - tile_offset[1];
+
+        uint32_t live = 0;
+        for (int c = col_begin; c < col_end; c++) {
+          live += cells[c];
+        }
+        row_counts[q - range[1].first] += live;
+      }
+    }
+  }
+}
+
+// Send the counts of pixels cut by the tile boundaries to the ranks owning
+// them, and add the counts of the pixels this rank owns from the others.
+// Only ranks whose tiles overlap the pixels of this one take part, which
+// are the direct neighbours unless tiles are smaller than a pixel.
+static void sum_partial_pixels(
+  const GameInfo* const game, const int scale,
+  const PixelRange range[2], uint32_t* restrict const counts)
+{
+  const int* const starts[2] = {game->row_start, game->col_start};
+  const int height = range[0].end - range[0].first;
+  const int width = range[1].end - range[1].first;
+
+  int parts[2][2];
+  for (int d = 0; d < 2; d++) {
+    overlapping_parts(starts[d], game->node_dims[d], range[d].first * scale,
+                      range[d].end * scale, &parts[d][0], &parts[d][1]);
+  }
+
+  const int ranks = (parts[0][1] - parts[0][0]) * (parts[1][1] - parts[1][0]);
+  MPI_Request* const request = (MPI_Request*)malloc(2 * ranks * sizeof(MPI_Request));
+  uint32_t** const received = (uint32_t**)malloc(ranks * sizeof(uint32_t*));
+  int (*const received_rect)[4] = malloc(ranks * sizeof(*received_rect));
+  int requests = 0, receives = 0;
+
+  for (int i = parts[0][0]; i < parts[0][1]; i++) {
+    for (int j = parts[1][0]; j < parts[1][1]; j++) {
+      int coords[2] = {i, j}, other;
+      MPI_Cart_rank(game->communicator, coords, &other);
+      if (other == game->rank) {
+        continue;
+      }
+
+      const PixelRange other_range[2] = {
+        pixel_range(starts[0][i], starts[0][i + 1], scale),
+        pixel_range(starts[1][j], starts[1][j + 1], scale)
+      };
+
+      // Our counts of the pixels the other rank owns
+      int send_first[2], send_size[2];
+      for (int d = 0; d < 2; d++) {
+        send_first[d] = max_int(range[d].first, other_range[d].owned);
+        send_size[d] = min_int(range[d].end, other_range[d].end) - send_first[d];
+      }
+      if (send_size[0] > 0 && send_size[1] > 0) {
+        int sizes[] = {height, width};
+        int offsets[] = {send_first[0] - range[0].first, send_first[1] - range[1].first};
+
+        // The type may be freed right away, pending sends keep it alive
+        MPI_Datatype send_type;
+        MPI_Type_create_subarray(2, sizes, send_size, offsets, MPI_ORDER_C, MPI_UINT32_T,
+                                 &send_type);
+        MPI_Type_commit(&send_type);
+        MPI_Isend(counts, 1, send_type, other, SNAPSHOT_TAG, game->communicator,
+                  &request[requests++]);
+        MPI_Type_free(&send_type);
+      }
+
+      // Its counts of the pixels we own, received contiguously
+      int recv_first[2], recv_size[2];
+      for (int d = 0; d < 2; d++) {
+        recv_first[d] = max_int(other_range[d].first, range[d].owned);
+        recv_size[d] = min_int(other_range[d].end, range[d].end) - recv_first[d];
+      }
+      if (recv_size[0] > 0 && recv_size[1] > 0) {
+        received[receives] = (uint32_t*)malloc(recv_size[0] * recv_size[1] * sizeof(uint32_t));
+        received_rect[receives][0] = recv_first[0] - range[0].first;
+        received_rect[receives][1] = recv_first[1] - range[1].first;
+        received_rect[receives][2] = recv_size[0];
+        received_rect[receives][3] = recv_size[1];
+        MPI_Irecv(received[receives], recv_size[0] * recv_size[1], MPI_UINT32_T, other,
+                  SNAPSHOT_TAG, game->communicator, &request[requests++]);
+        receives++;
+      }
+    }
+  }
+
+  MPI_Waitall(requests, request, MPI_STATUSES_IGNORE);
+
+  for (int k = 0; k < receives; k++) {
+    const int* const rect = received_rect[k];
+    for (int r = 0; r < rect[2]; r++) {
+      for (int c = 0; c < rect[3]; c++) {
+        counts[(rect[0] + r) * width + rect[1] + c] += received[k][r * rect[3] + c];
+      }
+    }
+    free(received[k]);
+  }
+
+  free(received_rect);
+  free(received);
+  free(request);
+}
+
+int start_snapshot(SnapshotWriter* const writer, GameInfo* const game, const long generation)
+{
+  const int scale = writer->scale;
+  int tile_offset[2], tile_size[2];
+  rank_tile(game, game->rank, tile_offset, tile_size);
+
+  const int board_size[] = {game->global_rows, game->global_cols};
+  int image_size[2], owned_first[2], owned_size[2];
+  PixelRange range[2];
+  for (int d = 0; d < 2; d++) {
+    image_size[d] = ceil_div(board_size[d], scale);
+    range[d] = pixel_range(tile_offset[d], tile_offset[d] + tile_size[d], scale);
+    owned_first[d] = range[d].owned;
+    owned_size[d] = range[d].end - range[d].owned;
+  }
+
+  const int height = range[0].end - range[0].first;
+  const int width = range[1].end - range[1].first;
+  uint32_t* const counts = (uint32_t*)calloc(height * width, sizeof(uint32_t));
+
+  bool* const tile = acquire_tile(game);
+  count_pixels(game, tile, scale, range, counts);
+  release_tile(game, tile, false);
+
+  if (scale > 1) {
+    sum_partial_pixels(game, scale, range, counts);
+  }
+
+  // Share of live cells, pixels on the bottom and right edges may cover
+  // fewer cells
+  const int pixels = owned_size[0] * owned_size[1];
+  writer->image = (uint8_t*)malloc(pixels > 0 ? pixels : 1);
+  for (int i = 0; i < owned_size[0]; i++) {
+    const int p = owned_first[0] + i;
+    const int rows = min_int((p + 1) * scale, board_size[0]) - p * scale;
+
+    for (int j = 0; j < owned_size[1]; j++) {
+      const int q = owned_first[1] + j;
+      const int cols = min_int((q + 1) * scale, board_size[1]) - q * scale;
+      const uint64_t cells = (uint64_t)rows * cols;
+      const uint64_t live = counts[(p - range[0].first) * width + q - range[1].first];
+      writer->image[i * owned_size[1] + j] = (uint8_t)((255 * live + cells / 2) / cells);
+    }
+  }
+  free(counts);
+
+  char* const path = (char*)malloc(strlen(writer->prefix) + 32);
+  sprintf(path, "%s%06ld.pgm", writer->prefix, generation);
+  int ierror = MPI_File_open(game->communicator, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                             MPI_INFO_NULL, &writer->file);
+  free(path);
+  if (ierror != MPI_SUCCESS) {
+    free(writer->image);
+    writer->image = NULL;
+    return ierror;
+  }
+
+  // Drop the tail of any longer file that was there before
+  MPI_File_set_size(writer->file, 0);
+
+  char header[64];
+  const int header_length = sprintf(header, "P5\n%d %d\n255\n", image_size[1], image_size[0]);
+  if (game->rank == 0) {
+    MPI_File_write_at(writer->file, 0, header, header_length, MPI_CHAR, MPI_STATUS_IGNORE);
+  }
+
+  // Ranks that own no pixel still join the collective write, with a plain
+  // view as subarrays can't be empty
+  MPI_Datatype file_type = MPI_UINT8_T;
+  if (pixels > 0) {
+    MPI_Type_create_subarray(2, image_size, owned_size, owned_first,
+                             MPI_ORDER_C, MPI_UINT8_T, &file_type);
+    MPI_Type_commit(&file_type);
+  }
+  MPI_File_set_view(writer->file, header_length, MPI_UINT8_T, file_type, "native", MPI_INFO_NULL);
+  if (pixels > 0) {
+    MPI_Type_free(&file_type);
+  }
+
+  writer->pending = true;
+  writer->generation = generation;
+  writer->communicator = game->communicator;
+  return MPI_File_iwrite_all(writer->file, writer->image, pixels, MPI_UINT8_T, &writer->request);
+}
+
+int finish_snapshot(SnapshotWriter* const writer)
+{
+  if (!writer->pending) {
+    return MPI_SUCCESS;
+  }
+
+  int ierror = MPI_Wait(&writer->request, MPI_STATUS_IGNORE);
+  MPI_File_close(&writer->file);
+  free(writer->image);
+  writer->image = NULL;
+  writer->pending = false;
+
+  // Report it on all ranks, like a failed open
+  MPI_Allreduce(MPI_IN_PLACE, &ierror, 1, MPI_INT, MPI_MAX, writer->communicator);
+  return ierror;
+}
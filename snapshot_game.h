@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mpi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+
+// Snapshots are binary PGM images of the board, a cheap replacement for
+// printing it every generation. With a scale above 1 every scale x scale
+// block of cells becomes one pixel whose gray value is its share of live
+// cells, brighter is denser, so images of large boards stay small.
+//
+// Each rank downsamples its own tile. Blocks cut by tile boundaries are
+// summed up by the rank whose tile holds their top left cell, so the image
+// doesn't depend on the decomposition. The pixels are then written with a
+// non-blocking collective MPI-IO write into PREFIX<generation>.pgm, which
+// runs while the next generations are computed. Only one snapshot is in
+// flight, it is finished before the next one starts.
+typedef struct SnapshotWriter {
+  const char* prefix;
+  int scale;
+
+  // snapshot in flight, its generation and the pixels of this rank, which
+  // must stay in place until the write completed
+  bool pending;
+  long generation;
+  MPI_Comm communicator;
+  MPI_File file;
+  MPI_Request request;
+  uint8_t* restrict image;
+} SnapshotWriter;
+
+void initialize_snapshot_writer(
+  SnapshotWriter* const writer, const char* const prefix, const int scale);
+
+// Collectively downsample the current generation and start writing it. The
+// previous snapshot must have been finished.
+int start_snapshot(SnapshotWriter* const writer, GameInfo* const game, const long generation);
+
+// Collectively wait for the snapshot in flight, if any, and close its file
+int finish_snapshot(SnapshotWriter* const writer);
@@ -0,0 +1,107 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "initialize_game.h"
+#include "sparse_game.h"
+
+static inline int map_cols(const GameInfo* const game) {
+  return game->block_cols + 2;
+}
+
+void initialize_sparse_game(GameInfo* const game, const bool sparse)
+{
+  game->sparse = sparse;
+  game->block_rows = (game->local_rows + SPARSE_BLOCK - 1) / SPARSE_BLOCK;
+  game->block_cols = (game->local_cols + SPARSE_BLOCK - 1) / SPARSE_BLOCK;
+  game->block_changed = NULL;
+  game->active_blocks = NULL;
+
+  if (!sparse) {
+    return;
+  }
+
+  // Everything counts as changed until the first generation is computed
+  game->block_changed = (bool*)malloc((game->block_rows + 2) * map_cols(game) * sizeof(bool));
+  reset_sparse_game(game);
+
+  game->active_blocks = (int*)malloc(game->block_rows * game->block_cols * sizeof(int));
+}
+
+void reset_sparse_game(GameInfo* const game)
+{
+  memset(game->block_changed, 1, (game->block_rows + 2) * map_cols(game) * sizeof(bool));
+}
+
+bool sparse_region_changed(
+  const GameInfo* const game,
+  const int* restrict const offset, const int* restrict const size)
+{
+  const int row_begin = sparse_block(offset[0], game->local_rows, game->block_rows);
+  const int row_end = sparse_block(offset[0] + size[0] - 1, game->local_rows, game->block_rows);
+  const int col_begin = sparse_block(offset[1], game->local_cols, game->block_cols);
+  const int col_end = sparse_block(offset[1] + size[1] - 1, game->local_cols, game->block_cols);
+
+  for (int r = row_begin; r <= row_end; r++) {
+    for (int c = col_begin; c <= col_end; c++) {
+      if (game->block_changed[r * map_cols(game) + c]) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void merge_sparse_halo(
+  GameInfo* const game,
+  const int* restrict const offset, const int* restrict const size)
+{
+  const int cols_pad = padded_cols(game);
+
+  for (int r = offset[0]; r < offset[0] + size[0]; r++) {
+    const bool* restrict const received = &game->current[r * cols_pad];
+    bool* restrict const kept = &game->previouse[r * cols_pad];
+    const int block_row = sparse_block(r, game->local_rows, game->block_rows);
+
+    for (int c = offset[1]; c < offset[1] + size[1]; c++) {
+      if (received[c] != kept[c]) {
+        kept[c] = received[c];
+        game->block_changed[block_row * map_cols(game) +
+                            sparse_block(c, game->local_cols, game->block_cols)] = true;
+      }
+    }
+  }
+}
+
+int mark_active_blocks(GameInfo* const game)
+{
+  const int cols = map_cols(game);
+  int active = 0;
+
+  // A block is active if it or one of its eight neighbours changed, the
+  // ring of the map holds the halos
+  for (int r = 1; r <= game->block_rows; r++) {
+    for (int c = 1; c <= game->block_cols; c++) {
+      const bool* restrict const above = &game->block_changed[(r - 1) * cols + c];
+      const bool* restrict const row   = &game->block_changed[(r + 0) * cols + c];
+      const bool* restrict const below = &game->block_changed[(r + 1) * cols + c];
+
+      if (above[-1] | above[0] | above[1] |
+          row[-1]   | row[0]   | row[1]   |
+          below[-1] | below[0] | below[1]) {
+        game->active_blocks[active++] = (r - 1) * game->block_cols + (c - 1);
+      }
+    }
+  }
+
+  memset(game->block_changed, 0, (game->block_rows + 2) * cols * sizeof(bool));
+  return active;
+}
+
+void destroy_sparse_game(GameInfo* const game)
+{
+  free(game->block_changed);
+  free(game->active_blocks);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "initialize_game.h"
+
+// Sparse updates split the tile into SPARSE_BLOCK x SPARSE_BLOCK blocks and
+// only recompute the blocks next to a block or halo that changed in the last
+// generation. The change map has a ring of entries around the blocks of the
+// tile for the halos, so it has (block_rows + 2) x (block_cols + 2) entries.
+//
+// A block that didn't change holds the same cells in current and previouse,
+// so skipping it leaves the right cells behind after the swap. For the same
+// reason the halos are kept equal in both buffers, and halo blocks whose
+// cells didn't change are sent as empty messages.
+#define SPARSE_BLOCK 64
+
+void initialize_sparse_game(GameInfo* const game, const bool sparse);
+
+// Mark every block as changed, after the cells were replaced from outside
+void reset_sparse_game(GameInfo* const game);
+
+// Entry of the change map holding padded tile row or column p, where n is
+// the tile size and blocks the block count along the same dimension
+static inline int sparse_block(const int p, const int n, const int blocks) {
+  if (p <= 0) {
+    return 0;
+  }
+  return p > n ? blocks + 1 : (p - 1) / SPARSE_BLOCK + 1;
+}
+
+// Whether any block overlapping the region of the padded tile changed in the
+// last generation
+bool sparse_region_changed(
+  const GameInfo* const game,
+  const int* restrict const offset, const int* restrict const size);
+
+// Mark the halo blocks of a received halo region that differ from the
+// previous exchange, and copy the region into previouse as well
+void merge_sparse_halo(
+  GameInfo* const game,
+  const int* restrict const offset, const int* restrict const size);
+
+// Collect the blocks to update into active_blocks and clear the change map
+// for the update to fill in. Returns the number of active blocks.
+int mark_active_blocks(GameInfo* const game);
+
+void destroy_sparse_game(GameInfo* const game);
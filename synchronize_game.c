@@ -5,7 +5,10 @@
 #include <string.h>
 
 #include "initialize_game.h"
+#include "packed_game.h"
+#include "sparse_game.h"
 #include "synchronize_game.h"
+#include "trace_game.h"
 
 static const int SEND_NORTH_TAG = 10;
 static const int SEND_NORTH_WEST_TAG = 11;
@@ -18,6 +21,20 @@ static const int SEND_SOUTH_EAST_TAG = 15;
 static const int SEND_EAST_TAG = 16;
 static const int SEND_WEST_TAG = 17;
 
+// Copy a halo block within the tile, for periodic boards where a rank is its
+// own neighbour
+static inline void copy_block(
+  bool* restrict const tile, const int cols_pad,
+  const int* restrict const size,
+  const int* restrict const from, const int* restrict const to)
+{
+  for (int r = 0; r < size[0]; r++) {
+    memcpy(&tile[(to[0] + r) * cols_pad + to[1]],
+           &tile[(from[0] + r) * cols_pad + from[1]],
+           size[1] * sizeof(bool));
+  }
+}
+
 static inline void synchronize_direction(
   const GameInfo* const game,
   const struct TopologyDirection* const send,
@@ -25,15 +42,767 @@ static inline void synchronize_direction(
   MPI_Request* const restrict request_array,
   const int tag)
 {
-  MPI_Isend(game->current, 1, send->send_type,
+  if (send->rank == game->rank) {
+    copy_block(game->current, padded_cols(game), send->block_size,
+               send->send_offset, recv->recv_offset);
+    request_array[0] = MPI_REQUEST_NULL;
+    request_array[1] = MPI_REQUEST_NULL;
+    return;
+  }
+
+  // Unchanged sparse blocks are sent as empty messages, the neighbour keeps
+  // the halo it already has
+  const int count = !game->sparse ||
+                    sparse_region_changed(game, send->send_offset, send->block_size);
+
+  MPI_Isend(game->current, count, send->send_type,
             send->rank, tag, game->communicator, &request_array[0]);
 
   MPI_Irecv(game->current, 1, recv->recv_type,
             recv->rank, tag, game->communicator, &request_array[1]);
 }
 
-void synchronize_game(const GameInfo* const game)
+// Directions in the order of the exchange. Each one sends the border block
+// facing send[i] and receives into the halo facing recv[i], with the tag
+// SEND_NORTH_TAG + i.
+static inline void exchange_directions(
+  GameInfo* const game,
+  struct TopologyDirection** const send, struct TopologyDirection** const recv)
+{
+  struct Topology* const topology = &game->topology;
+
+  send[0] = &topology->north;      recv[0] = &topology->south;
+  send[1] = &topology->north_west; recv[1] = &topology->south_east;
+  send[2] = &topology->north_east; recv[2] = &topology->south_west;
+  send[3] = &topology->south;      recv[3] = &topology->north;
+  send[4] = &topology->south_west; recv[4] = &topology->north_east;
+  send[5] = &topology->south_east; recv[5] = &topology->north_west;
+  send[6] = &topology->east;       recv[6] = &topology->west;
+  send[7] = &topology->west;       recv[7] = &topology->east;
+}
+
+// Persistent requests for both buffers, leaving out the periodic directions
+// where a rank is its own neighbour, those are copied on start
+static void create_persistent_exchange(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  game->persistent_request = (MPI_Request*)malloc(2 * 16 * sizeof(MPI_Request));
+
+  for (int set = 0; set < 2; set++) {
+    bool* const tile = game->exchange_tile[set];
+    MPI_Request* const request = &game->persistent_request[set * 16];
+    int count = 0;
+
+    for (int i = 0; i < 8; i++) {
+      if (send[i]->rank == game->rank) {
+        continue;
+      }
+
+      game->persistent_direction[count / 2] = i;
+      MPI_Send_init(tile, 1, send[i]->send_type, send[i]->rank, SEND_NORTH_TAG + i,
+                    game->communicator, &request[count++]);
+      MPI_Recv_init(tile, 1, recv[i]->recv_type, recv[i]->rank, SEND_NORTH_TAG + i,
+                    game->communicator, &request[count++]);
+    }
+
+    game->persistent_count[set] = count;
+  }
+}
+
+// The graph has an edge for every direction with a neighbour. Destinations
+// are listed in exchange order and sources in the order of the opposite
+// directions, so when two ranks are neighbours on several sides (small
+// periodic grids) the k-th message between them still lands in the right
+// halo.
+static void create_neighbor_exchange(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  struct NeighborExchange* const neighbor = &game->neighbor;
+  int destinations[8], sources[8], weights[8];
+  neighbor->send_count = 0;
+  neighbor->recv_count = 0;
+
+  for (int i = 0; i < 8; i++) {
+    neighbor->counts[i] = 1;
+    neighbor->send_displacements[i] = 0;
+    weights[i] = 1;
+
+    if (send[i]->rank != MPI_PROC_NULL) {
+      destinations[neighbor->send_count] = send[i]->rank;
+      neighbor->send_types[neighbor->send_count++] = send[i]->send_type;
+    }
+    if (recv[i]->rank != MPI_PROC_NULL) {
+      sources[neighbor->recv_count] = recv[i]->rank;
+      neighbor->recv_types[neighbor->recv_count++] = recv[i]->recv_type;
+    }
+  }
+
+  MPI_Dist_graph_create_adjacent(game->communicator,
+                                 neighbor->recv_count, sources, weights,
+                                 neighbor->send_count, destinations, weights,
+                                 MPI_INFO_NULL, 0, &neighbor->communicator);
+}
+
+// Row and column side of recv[i], the send side is the opposite one
+static const int RECV_SIDES[8][2] = {
+  { 1,  0}, { 1,  1}, { 1, -1},  // south, south east, south west
+  {-1,  0}, {-1,  1}, {-1, -1},  // north, north east, north west
+  { 0, -1}, { 0,  1}             // west, east
+};
+
+// Halo offset facing recv[i] in a padded tile of rows x cols, matching the
+// receive offsets set up in initialize_game.c
+static inline void halo_offset(
+  const int i, const int rows, const int cols, const int halo, int* const offset)
+{
+  const int* const sides = RECV_SIDES[i];
+  offset[0] = sides[0] < 0 ? 0 : (sides[0] > 0 ? rows + halo : halo);
+  offset[1] = sides[1] < 0 ? 0 : (sides[1] > 0 ? cols + halo : halo);
+}
+
+// Offset of the border block facing send[i] in a padded tile of rows x cols,
+// matching the send offsets set up in initialize_game.c
+static inline void border_offset(
+  const int i, const int rows, const int cols, const int halo, int* const offset)
+{
+  const int* const sides = RECV_SIDES[i];
+  offset[0] = sides[0] < 0 ? rows : halo;
+  offset[1] = sides[1] < 0 ? cols : halo;
+}
+
+// A window per buffer, and for every direction the datatype of the halo
+// block in the neighbours tile that our border block is put into. Tiles
+// differ in size, so the neighbours tile comes from the decomposition.
+static void create_rma_exchange(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  struct RmaExchange* const rma = &game->rma;
+  const MPI_Aint tile_bytes = (game->local_rows + 2 * game->halo) * padded_cols(game) * sizeof(bool);
+
+  // A single rank only copies its own borders, and some MPI implementations
+  // have no one-sided component for a lone process
+  int size;
+  MPI_Comm_size(game->communicator, &size);
+  for (int set = 0; set < 2; set++) {
+    rma->window[set] = MPI_WIN_NULL;
+    if (size > 1) {
+      MPI_Win_create(game->exchange_tile[set], tile_bytes, sizeof(bool), MPI_INFO_NULL,
+                     game->communicator, &rma->window[set]);
+    }
+  }
+
+  int ranks[8];
+  int count = 0;
+
+  for (int i = 0; i < 8; i++) {
+    rma->target_types[i] = MPI_DATATYPE_NULL;
+
+    const int neighbour = send[i]->rank;
+    if (neighbour == MPI_PROC_NULL || neighbour == game->rank) {
+      continue;
+    }
+
+    int tile_offset[2], tile_size[2];
+    rank_tile(game, neighbour, tile_offset, tile_size);
+
+    int padded_size[] = {tile_size[0] + 2 * game->halo, tile_size[1] + 2 * game->halo};
+    int target_offset[2];
+    halo_offset(i, tile_size[0], tile_size[1], game->halo, target_offset);
+    MPI_Type_create_subarray(2, padded_size, send[i]->block_size, target_offset,
+                             MPI_ORDER_C, MPI_C_BOOL, &rma->target_types[i]);
+    MPI_Type_commit(&rma->target_types[i]);
+
+    // Groups can't hold a rank twice
+    bool listed = false;
+    for (int j = 0; j < count; j++) {
+      listed |= ranks[j] == neighbour;
+    }
+    if (!listed) {
+      ranks[count++] = neighbour;
+    }
+  }
+
+  // Ranks without remote neighbours expose to and access nobody, the empty
+  // group is predefined and never freed
+  if (count == 0) {
+    rma->group = MPI_GROUP_EMPTY;
+    return;
+  }
+
+  MPI_Group world_group;
+  MPI_Comm_group(game->communicator, &world_group);
+  MPI_Group_incl(world_group, count, ranks, &rma->group);
+  MPI_Group_free(&world_group);
+}
+
+void allocate_shared_tiles(GameInfo* const game)
+{
+  struct SharedExchange* const shared = &game->shared;
+  MPI_Comm_split_type(game->communicator, MPI_COMM_TYPE_SHARED, game->rank,
+                      MPI_INFO_NULL, &shared->communicator);
+
+  // Let the library place every tile in the memory of its own rank
+  MPI_Info info;
+  MPI_Info_create(&info);
+  MPI_Info_set(info, "alloc_shared_noncontig", "true");
+
+  const size_t tile_bytes = (game->local_rows + 2 * game->halo) * padded_cols(game) * sizeof(bool);
+  bool* tiles;
+  MPI_Win_allocate_shared(2 * tile_bytes, sizeof(bool), info, shared->communicator,
+                          &tiles, &shared->window);
+  MPI_Info_free(&info);
+
+  memset(tiles, 0, 2 * tile_bytes);
+  game->current = tiles;
+  game->previouse = tiles + tile_bytes;
+
+  // Stores to the window are made visible with MPI_Win_sync, which needs a
+  // passive target epoch
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, shared->window);
+  shared->barrier = MPI_REQUEST_NULL;
+}
+
+// Locate the border blocks of the neighbours on this node in the shared
+// window. The other neighbours exchange messages as in the derived exchange.
+static void create_shared_exchange(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  struct SharedExchange* const shared = &game->shared;
+  MPI_Group group, node_group;
+  MPI_Comm_group(game->communicator, &group);
+  MPI_Comm_group(shared->communicator, &node_group);
+
+  for (int i = 0; i < 8; i++) {
+    shared->source[i][0] = NULL;
+    shared->source[i][1] = NULL;
+
+    int node_rank = MPI_UNDEFINED;
+    if (send[i]->rank != MPI_PROC_NULL && send[i]->rank != game->rank) {
+      MPI_Group_translate_ranks(group, 1, &send[i]->rank, node_group, &node_rank);
+    }
+    shared->send_shared[i] = node_rank != MPI_UNDEFINED;
+
+    const int neighbour = recv[i]->rank;
+    node_rank = MPI_UNDEFINED;
+    if (neighbour != MPI_PROC_NULL && neighbour != game->rank) {
+      MPI_Group_translate_ranks(group, 1, &neighbour, node_group, &node_rank);
+    }
+    if (node_rank == MPI_UNDEFINED) {
+      continue;
+    }
+
+    int tile_offset[2], tile_size[2];
+    rank_tile(game, neighbour, tile_offset, tile_size);
+
+    MPI_Aint window_bytes;
+    int unit;
+    bool* tiles;
+    MPI_Win_shared_query(shared->window, node_rank, &window_bytes, &unit, &tiles);
+
+    int offset[2];
+    border_offset(i, tile_size[0], tile_size[1], game->halo, offset);
+    shared->source_cols[i] = tile_size[1] + 2 * game->halo;
+
+    const size_t tile_bytes = (tile_size[0] + 2 * game->halo) * shared->source_cols[i] * sizeof(bool);
+    const size_t border = offset[0] * shared->source_cols[i] + offset[1];
+    shared->source[i][0] = tiles + border;
+    shared->source[i][1] = tiles + tile_bytes + border;
+  }
+
+  MPI_Group_free(&group);
+  MPI_Group_free(&node_group);
+}
+
+void create_exchange(GameInfo* const game)
+{
+  game->exchange_tile[0] = game->current;
+  game->exchange_tile[1] = game->previouse;
+  game->persistent_request = NULL;
+  game->neighbor.communicator = MPI_COMM_NULL;
+  game->rma.group = MPI_GROUP_NULL;
+
+  if (game->storage != GAME_STORAGE_BYTE) {
+    return;
+  }
+
+  if (game->exchange == GAME_EXCHANGE_PERSISTENT) {
+    create_persistent_exchange(game);
+  } else if (game->exchange == GAME_EXCHANGE_NEIGHBORHOOD) {
+    create_neighbor_exchange(game);
+  } else if (game->exchange == GAME_EXCHANGE_RMA) {
+    create_rma_exchange(game);
+  } else if (game->exchange == GAME_EXCHANGE_SHARED) {
+    create_shared_exchange(game);
+  }
+}
+
+void free_exchange(GameInfo* const game)
+{
+  if (game->persistent_request != NULL) {
+    for (int set = 0; set < 2; set++) {
+      for (int i = 0; i < game->persistent_count[set]; i++) {
+        MPI_Request_free(&game->persistent_request[set * 16 + i]);
+      }
+    }
+    free(game->persistent_request);
+    game->persistent_request = NULL;
+  }
+
+  if (game->neighbor.communicator != MPI_COMM_NULL) {
+    MPI_Comm_free(&game->neighbor.communicator);
+  }
+
+  if (game->rma.group != MPI_GROUP_NULL) {
+    for (int set = 0; set < 2; set++) {
+      if (game->rma.window[set] != MPI_WIN_NULL) {
+        MPI_Win_free(&game->rma.window[set]);
+      }
+    }
+    for (int i = 0; i < 8; i++) {
+      if (game->rma.target_types[i] != MPI_DATATYPE_NULL) {
+        MPI_Type_free(&game->rma.target_types[i]);
+      }
+    }
+    if (game->rma.group != MPI_GROUP_EMPTY) {
+      MPI_Group_free(&game->rma.group);
+    }
+    game->rma.group = MPI_GROUP_NULL;
+  }
+
+  // The tiles go with the shared window
+  if (game->storage == GAME_STORAGE_BYTE && game->exchange == GAME_EXCHANGE_SHARED) {
+    MPI_Wait(&game->shared.barrier, MPI_STATUS_IGNORE);
+    MPI_Win_unlock_all(game->shared.window);
+    MPI_Win_free(&game->shared.window);
+    MPI_Comm_free(&game->shared.communicator);
+    game->current = NULL;
+    game->previouse = NULL;
+  }
+}
+
+// Which of the two buffers is current, all ranks swap in lockstep so this
+// is the same everywhere
+static inline int current_set(const GameInfo* const game)
+{
+  return game->current == game->exchange_tile[0] ? 0 : 1;
+}
+
+static void start_synchronize_persistent_game(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  for (int i = 0; i < 8; i++) {
+    if (send[i]->rank == game->rank) {
+      copy_block(game->current, padded_cols(game), send[i]->block_size,
+                 send[i]->send_offset, recv[i]->recv_offset);
+    }
+  }
+
+  const int set = current_set(game);
+  MPI_Startall(game->persistent_count[set], &game->persistent_request[set * 16]);
+}
+
+// Sends and receives go through the same buffer, so the receive side is
+// addressed from MPI_BOTTOM to keep the two buffer arguments apart
+static void start_synchronize_neighbor_game(GameInfo* const game)
+{
+  struct NeighborExchange* const neighbor = &game->neighbor;
+
+  MPI_Aint tile_address;
+  MPI_Get_address(game->current, &tile_address);
+  for (int i = 0; i < neighbor->recv_count; i++) {
+    neighbor->recv_displacements[i] = tile_address;
+  }
+
+  MPI_Ineighbor_alltoallw(game->current, neighbor->counts, neighbor->send_displacements,
+                          neighbor->send_types,
+                          MPI_BOTTOM, neighbor->counts, neighbor->recv_displacements,
+                          neighbor->recv_types,
+                          neighbor->communicator, &game->request[0]);
+}
+
+// PSCW epochs on the window of the current buffer. The exposure epoch lets
+// the neighbours put into our halos, the access epoch puts our border blocks
+// into theirs. Both end in finish, so the update of the interior can run
+// meanwhile.
+static void start_synchronize_rma_game(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  const MPI_Win window = game->rma.window[current_set(game)];
+  if (window != MPI_WIN_NULL) {
+    MPI_Win_post(game->rma.group, 0, window);
+    MPI_Win_start(game->rma.group, 0, window);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    if (send[i]->rank == game->rank) {
+      copy_block(game->current, padded_cols(game), send[i]->block_size,
+                 send[i]->send_offset, recv[i]->recv_offset);
+    } else if (send[i]->rank != MPI_PROC_NULL) {
+      MPI_Put(game->current, 1, send[i]->send_type,
+              send[i]->rank, 0, 1, game->rma.target_types[i], window);
+    }
+  }
+}
+
+static void finish_synchronize_rma_game(GameInfo* const game)
+{
+  const MPI_Win window = game->rma.window[current_set(game)];
+  if (window != MPI_WIN_NULL) {
+    TRACE_SYNC(TRACE_WINDOW_COMPLETE, MPI_Win_complete(window));
+    TRACE_SYNC(TRACE_WINDOW_WAIT, MPI_Win_wait(window));
+  }
+}
+
+// Neighbours on the node read the border blocks of our current buffer
+// straight from the window. The barrier started here tells them it is
+// written, and the one started in finish that they are done reading it, so
+// that the next update can write the other buffer, which they read in the
+// previous exchange. Only the messages to other nodes go through MPI.
+static void start_synchronize_shared_game(GameInfo* const game)
+{
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  struct SharedExchange* const shared = &game->shared;
+  TRACE_SYNC(TRACE_SHARED_BARRIER, MPI_Wait(&shared->barrier, MPI_STATUS_IGNORE));
+  MPI_Win_sync(shared->window);
+  MPI_Ibarrier(shared->communicator, &shared->barrier);
+
+  for (int i = 0; i < 8; i++) {
+    MPI_Request* const request = &game->request[2 * i];
+    request[0] = MPI_REQUEST_NULL;
+    request[1] = MPI_REQUEST_NULL;
+
+    if (send[i]->rank == game->rank) {
+      copy_block(game->current, padded_cols(game), send[i]->block_size,
+                 send[i]->send_offset, recv[i]->recv_offset);
+      continue;
+    }
+
+    // Neighbours on the node read the border themselves
+    if (!shared->send_shared[i]) {
+      MPI_Isend(game->current, 1, send[i]->send_type, send[i]->rank,
+                SEND_NORTH_TAG + i, game->communicator, &request[0]);
+    }
+    if (shared->source[i][0] == NULL) {
+      MPI_Irecv(game->current, 1, recv[i]->recv_type, recv[i]->rank,
+                SEND_NORTH_TAG + i, game->communicator, &request[1]);
+    }
+  }
+}
+
+static void finish_synchronize_shared_game(GameInfo* const game)
 {
+  struct TopologyDirection* send[8];
+  struct TopologyDirection* recv[8];
+  exchange_directions(game, send, recv);
+
+  struct SharedExchange* const shared = &game->shared;
+  TRACE_SYNC(TRACE_SHARED_BARRIER, MPI_Wait(&shared->barrier, MPI_STATUS_IGNORE));
+  MPI_Win_sync(shared->window);
+
+  const int set = current_set(game);
+  const int cols_pad = padded_cols(game);
+  for (int i = 0; i < 8; i++) {
+    const bool* const source = shared->source[i][set];
+    if (source == NULL) {
+      continue;
+    }
+
+    const int* const size = recv[i]->block_size;
+    const int* const to = recv[i]->recv_offset;
+    for (int r = 0; r < size[0]; r++) {
+      memcpy(&game->current[(to[0] + r) * cols_pad + to[1]],
+             &source[r * shared->source_cols[i]],
+             size[1] * sizeof(bool));
+    }
+  }
+
+  MPI_Ibarrier(shared->communicator, &shared->barrier);
+
+  // Deep halos run several updates before the next exchange, the second one
+  // already writes the buffer read just now
+  if (game->halo > 1) {
+    TRACE_SYNC(TRACE_SHARED_BARRIER, MPI_Wait(&shared->barrier, MPI_STATUS_IGNORE));
+  }
+
+  TRACE_WAITALL(16, game->request, game->status, NULL);
+}
+
+// Merge a received sparse halo, the self copy of periodic tiles always counts
+// as received
+static inline void finish_sparse_direction(
+  GameInfo* const game,
+  const struct TopologyDirection* const recv,
+  const MPI_Status* const status)
+{
+  if (recv->rank == MPI_PROC_NULL) {
+    return;
+  }
+
+  int count = 1;
+  if (recv->rank != game->rank) {
+    MPI_Get_count(status, MPI_BYTE, &count);
+  }
+
+  if (count > 0) {
+    merge_sparse_halo(game, recv->recv_offset, recv->block_size);
+  }
+}
+
+// Directions of the request pairs of the column and of the row messages
+// of the packed and aggregated exchanges, the halos from west and east and
+// from south and north
+#ifdef GAME_TRACE
+static const int COLUMN_DIRECTIONS[2] = {6, 7};
+static const int ROW_DIRECTIONS[2] = {0, 3};
+#endif
+
+// Packed tiles can't describe single bit columns with MPI datatypes, so
+// east/west halos are copied into contiguous word buffers first. Doing the
+// columns before the full rows also carries the corner cells along with the
+// north/south rows, so no separate corner messages are needed.
+static void start_synchronize_packed_game(const GameInfo* const game)
+{
+  const int column_words = packed_column_words(game->local_rows);
+  const int last_col = game->local_cols;
+
+  uint64_t* restrict const send_west = &game->packed_halo[0 * column_words];
+  uint64_t* restrict const send_east = &game->packed_halo[1 * column_words];
+  uint64_t* restrict const recv_west = &game->packed_halo[2 * column_words];
+  uint64_t* restrict const recv_east = &game->packed_halo[3 * column_words];
+
+  // east <-> west
+  pack_column(game->packed_current, send_west, 1, game->local_rows, game->local_cols);
+  pack_column(game->packed_current, send_east, last_col, game->local_rows, game->local_cols);
+
+  // A periodic rank that is its own east/west neighbour keeps the columns
+  if (game->topology.east.rank == game->rank) {
+    unpack_column(send_east, game->packed_current, 0, game->local_rows, game->local_cols);
+    unpack_column(send_west, game->packed_current, last_col + 1, game->local_rows, game->local_cols);
+    game->request[0] = game->request[1] = game->request[2] = game->request[3] = MPI_REQUEST_NULL;
+    return;
+  }
+
+  MPI_Isend(send_east, column_words, MPI_UINT64_T, game->topology.east.rank,
+            SEND_EAST_TAG, game->communicator, &game->request[0]);
+  MPI_Irecv(recv_west, column_words, MPI_UINT64_T, game->topology.west.rank,
+            SEND_EAST_TAG, game->communicator, &game->request[1]);
+  MPI_Isend(send_west, column_words, MPI_UINT64_T, game->topology.west.rank,
+            SEND_WEST_TAG, game->communicator, &game->request[2]);
+  MPI_Irecv(recv_east, column_words, MPI_UINT64_T, game->topology.east.rank,
+            SEND_WEST_TAG, game->communicator, &game->request[3]);
+}
+
+static void finish_synchronize_packed_game(const GameInfo* const game)
+{
+  const int words = game->packed_cols;
+  const int column_words = packed_column_words(game->local_rows);
+  const int last_row = game->local_rows;
+  const int last_col = game->local_cols;
+
+  const uint64_t* restrict const recv_west = &game->packed_halo[2 * column_words];
+  const uint64_t* restrict const recv_east = &game->packed_halo[3 * column_words];
+
+  TRACE_WAITALL(4, game->request, game->status, COLUMN_DIRECTIONS);
+
+  if (game->topology.west.rank != MPI_PROC_NULL && game->topology.west.rank != game->rank) {
+    unpack_column(recv_west, game->packed_current, 0, game->local_rows, game->local_cols);
+  }
+  if (game->topology.east.rank != MPI_PROC_NULL && game->topology.east.rank != game->rank) {
+    unpack_column(recv_east, game->packed_current, last_col + 1, game->local_rows, game->local_cols);
+  }
+
+  // north <-> south, full padded rows including the corners received above
+  if (game->topology.north.rank == game->rank) {
+    memcpy(&game->packed_current[(last_row + 1) * words], &game->packed_current[1 * words],
+           words * sizeof(uint64_t));
+    memcpy(&game->packed_current[0 * words], &game->packed_current[last_row * words],
+           words * sizeof(uint64_t));
+    return;
+  }
+
+  MPI_Isend(&game->packed_current[1 * words], words, MPI_UINT64_T,
+            game->topology.north.rank, SEND_NORTH_TAG, game->communicator, &game->request[4]);
+  MPI_Irecv(&game->packed_current[(last_row + 1) * words], words, MPI_UINT64_T,
+            game->topology.south.rank, SEND_NORTH_TAG, game->communicator, &game->request[5]);
+  MPI_Isend(&game->packed_current[last_row * words], words, MPI_UINT64_T,
+            game->topology.south.rank, SEND_SOUTH_TAG, game->communicator, &game->request[6]);
+  MPI_Irecv(&game->packed_current[0 * words], words, MPI_UINT64_T,
+            game->topology.north.rank, SEND_SOUTH_TAG, game->communicator, &game->request[7]);
+
+  TRACE_WAITALL(4, &game->request[4], &game->status[4], ROW_DIRECTIONS);
+}
+
+// Copy halo columns of the tile from/to a contiguous buffer of rows x width
+static inline void copy_columns(
+  bool* restrict const tile, const int cols_pad,
+  bool* restrict const buffer, const int rows, const int width,
+  const int row, const int col, const bool to_buffer)
+{
+  for (int r = 0; r < rows; r++) {
+    bool* restrict const cells = &tile[(row + r) * cols_pad + col];
+    if (to_buffer) {
+      memcpy(&buffer[r * width], cells, width * sizeof(bool));
+    } else {
+      memcpy(cells, &buffer[r * width], width * sizeof(bool));
+    }
+  }
+}
+
+// Byte counterpart of the packed exchange. The east/west halo columns are
+// copied into contiguous buffers by hand instead of by MPI through strided
+// datatypes, and once they are in place the north/south halos are full
+// padded rows that already hold the corners. 4 messages instead of 16, all
+// of them contiguous.
+static void start_synchronize_aggregated_game(const GameInfo* const game)
+{
+  const int halo = game->halo;
+  const int rows = game->local_rows;
+  const int cols_pad = padded_cols(game);
+  const int block = halo * rows;
+
+  bool* restrict const send_west = &game->halo_buffer[0 * block];
+  bool* restrict const send_east = &game->halo_buffer[1 * block];
+  bool* restrict const recv_west = &game->halo_buffer[2 * block];
+  bool* restrict const recv_east = &game->halo_buffer[3 * block];
+
+  // east <-> west
+  copy_columns(game->current, cols_pad, send_west, rows, halo, halo, halo, true);
+  copy_columns(game->current, cols_pad, send_east, rows, halo, halo, game->local_cols, true);
+
+  // A periodic rank that is its own east/west neighbour keeps the columns
+  if (game->topology.east.rank == game->rank) {
+    copy_columns(game->current, cols_pad, send_east, rows, halo, halo, 0, false);
+    copy_columns(game->current, cols_pad, send_west, rows, halo, halo,
+                 game->local_cols + halo, false);
+    game->request[0] = game->request[1] = game->request[2] = game->request[3] = MPI_REQUEST_NULL;
+    return;
+  }
+
+  MPI_Isend(send_east, block, MPI_C_BOOL, game->topology.east.rank,
+            SEND_EAST_TAG, game->communicator, &game->request[0]);
+  MPI_Irecv(recv_west, block, MPI_C_BOOL, game->topology.west.rank,
+            SEND_EAST_TAG, game->communicator, &game->request[1]);
+  MPI_Isend(send_west, block, MPI_C_BOOL, game->topology.west.rank,
+            SEND_WEST_TAG, game->communicator, &game->request[2]);
+  MPI_Irecv(recv_east, block, MPI_C_BOOL, game->topology.east.rank,
+            SEND_WEST_TAG, game->communicator, &game->request[3]);
+}
+
+static void finish_synchronize_aggregated_game(const GameInfo* const game)
+{
+  const int halo = game->halo;
+  const int rows = game->local_rows;
+  const int cols_pad = padded_cols(game);
+  const int block = halo * rows;
+  const int row_cells = halo * cols_pad;
+
+  bool* restrict const recv_west = &game->halo_buffer[2 * block];
+  bool* restrict const recv_east = &game->halo_buffer[3 * block];
+
+  TRACE_WAITALL(4, game->request, game->status, COLUMN_DIRECTIONS);
+
+  if (game->topology.west.rank != MPI_PROC_NULL && game->topology.west.rank != game->rank) {
+    copy_columns(game->current, cols_pad, recv_west, rows, halo, halo, 0, false);
+  }
+  if (game->topology.east.rank != MPI_PROC_NULL && game->topology.east.rank != game->rank) {
+    copy_columns(game->current, cols_pad, recv_east, rows, halo, halo,
+                 game->local_cols + halo, false);
+  }
+
+  // north <-> south, full padded rows including the corners received above
+  bool* const first_rows = &game->current[halo * cols_pad];
+  bool* const last_rows = &game->current[rows * cols_pad];
+  bool* const north_halo = &game->current[0];
+  bool* const south_halo = &game->current[(rows + halo) * cols_pad];
+
+  if (game->topology.north.rank == game->rank) {
+    memcpy(south_halo, first_rows, row_cells * sizeof(bool));
+    memcpy(north_halo, last_rows, row_cells * sizeof(bool));
+    return;
+  }
+
+  MPI_Isend(first_rows, row_cells, MPI_C_BOOL, game->topology.north.rank,
+            SEND_NORTH_TAG, game->communicator, &game->request[4]);
+  MPI_Irecv(south_halo, row_cells, MPI_C_BOOL, game->topology.south.rank,
+            SEND_NORTH_TAG, game->communicator, &game->request[5]);
+  MPI_Isend(last_rows, row_cells, MPI_C_BOOL, game->topology.south.rank,
+            SEND_SOUTH_TAG, game->communicator, &game->request[6]);
+  MPI_Irecv(north_halo, row_cells, MPI_C_BOOL, game->topology.north.rank,
+            SEND_SOUTH_TAG, game->communicator, &game->request[7]);
+
+  TRACE_WAITALL(4, &game->request[4], &game->status[4], ROW_DIRECTIONS);
+}
+
+// Requests in flight between start and finish
+static inline MPI_Request* pending_requests(GameInfo* const game, int* const count)
+{
+  if (game->storage == GAME_STORAGE_PACKED || game->exchange == GAME_EXCHANGE_AGGREGATED) {
+    *count = 4;
+  } else if (game->exchange == GAME_EXCHANGE_PERSISTENT) {
+    const int set = current_set(game);
+    *count = game->persistent_count[set];
+    return &game->persistent_request[set * 16];
+  } else if (game->exchange == GAME_EXCHANGE_NEIGHBORHOOD) {
+    *count = 1;
+  } else if (game->exchange == GAME_EXCHANGE_RMA) {
+    // Epochs only progress in their synchronization calls
+    *count = 0;
+  } else {
+    *count = 16;
+  }
+
+  return game->request;
+}
+
+void start_synchronize_game(GameInfo* const game)
+{
+  if (game->storage == GAME_STORAGE_PACKED) {
+    start_synchronize_packed_game(game);
+    return;
+  }
+
+  if (game->exchange == GAME_EXCHANGE_AGGREGATED) {
+    start_synchronize_aggregated_game(game);
+    return;
+  }
+  if (game->exchange == GAME_EXCHANGE_PERSISTENT) {
+    start_synchronize_persistent_game(game);
+    return;
+  }
+  if (game->exchange == GAME_EXCHANGE_NEIGHBORHOOD) {
+    start_synchronize_neighbor_game(game);
+    return;
+  }
+  if (game->exchange == GAME_EXCHANGE_RMA) {
+    start_synchronize_rma_game(game);
+    return;
+  }
+  if (game->exchange == GAME_EXCHANGE_SHARED) {
+    start_synchronize_shared_game(game);
+    return;
+  }
+
   // north -> south
   synchronize_direction(game,
                         &game->topology.north, &game->topology.south,
@@ -68,6 +837,53 @@ void synchronize_game(const GameInfo* const game)
   synchronize_direction(game,
                         &game->topology.west, &game->topology.east,
                         &game->request[14], SEND_WEST_TAG);
+}
+
+void progress_synchronize_game(GameInfo* const game)
+{
+  // MPI only moves non-blocking messages forward inside MPI calls
+  int flag, count;
+  MPI_Request* const request = pending_requests(game, &count);
+  MPI_Testall(count, request, &flag, MPI_STATUSES_IGNORE);
+}
+
+void finish_synchronize_game(GameInfo* const game)
+{
+  if (game->storage == GAME_STORAGE_PACKED) {
+    finish_synchronize_packed_game(game);
+  } else if (game->exchange == GAME_EXCHANGE_AGGREGATED) {
+    finish_synchronize_aggregated_game(game);
+  } else if (game->exchange == GAME_EXCHANGE_RMA) {
+    finish_synchronize_rma_game(game);
+  } else if (game->exchange == GAME_EXCHANGE_SHARED) {
+    finish_synchronize_shared_game(game);
+  } else if (game->exchange == GAME_EXCHANGE_NEIGHBORHOOD) {
+    TRACE_SYNC(TRACE_NEIGHBOR_EXCHANGE, MPI_Wait(&game->request[0], &game->status[0]));
+  } else if (game->exchange == GAME_EXCHANGE_PERSISTENT) {
+    const int set = current_set(game);
+    TRACE_WAITALL(game->persistent_count[set], &game->persistent_request[set * 16],
+                  game->status, game->persistent_direction);
+  } else {
+    TRACE_WAITALL(16, game->request, game->status, NULL);
+  }
+
+  // Receives are the odd requests of each direction pair
+  if (game->sparse) {
+    finish_sparse_direction(game, &game->topology.south, &game->status[1]);
+    finish_sparse_direction(game, &game->topology.south_east, &game->status[3]);
+    finish_sparse_direction(game, &game->topology.south_west, &game->status[5]);
+    finish_sparse_direction(game, &game->topology.north, &game->status[7]);
+    finish_sparse_direction(game, &game->topology.north_east, &game->status[9]);
+    finish_sparse_direction(game, &game->topology.north_west, &game->status[11]);
+    finish_sparse_direction(game, &game->topology.west, &game->status[13]);
+    finish_sparse_direction(game, &game->topology.east, &game->status[15]);
+  }
 
-  MPI_Waitall(16, game->request, game->status);
+  game->halo_age = 0;
+}
+
+void synchronize_game(GameInfo* const game)
+{
+  start_synchronize_game(game);
+  finish_synchronize_game(game);
 }
@@ -1,5 +1,32 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "initialize_game.h"
 
-void synchronize_game(const GameInfo* const game);
+// True when the halos have been used up by halo generations since the last
+// exchange. With the default halo width of one this is every generation.
+static inline bool halo_expired(const GameInfo* const game) {
+  return game->halo_age >= game->halo;
+}
+
+// Set up and free the requests, communicators and windows of the exchanges
+// bound to the tile buffers. free_exchange() also releases the buffers of
+// allocate_shared_tiles().
+void create_exchange(GameInfo* const game);
+void free_exchange(GameInfo* const game);
+
+// Allocate current and previouse in a window shared by the ranks of a node,
+// for the shared exchange
+void allocate_shared_tiles(GameInfo* const game);
+
+// Exchange all halos and wait for them
+void synchronize_game(GameInfo* const game);
+
+// Split-phase halo exchange. Between start and finish the halo cells must not
+// be read and the tile must not be modified, update_game_interior() is safe.
+// progress_synchronize_game() can be called meanwhile to let MPI move the
+// messages along.
+void start_synchronize_game(GameInfo* const game);
+void progress_synchronize_game(GameInfo* const game);
+void finish_synchronize_game(GameInfo* const game);
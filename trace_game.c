@@ -0,0 +1,228 @@
+#ifdef GAME_TRACE
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark_game.h"
+#include "debug_game.h"
+#include "trace_game.h"
+
+enum TraceKind {
+  TRACE_PHASE_EVENT,      // value is the GamePhase
+  TRACE_DIRECTION_EVENT,  // value is the exchange direction
+  TRACE_POPULATION_EVENT, // value is the number of live cells of the tile
+  TRACE_SYNC_EVENT        // value is the TraceSync
+};
+
+typedef struct TraceEvent {
+  double begin;
+  double end;
+  long generation;
+  unsigned long long value;
+  enum TraceKind kind;
+} TraceEvent;
+
+// The trace of this rank, events is NULL while tracing is off
+static struct {
+  const char* prefix;
+  enum GameTraceFormat format;
+  int rank;
+  double origin;
+  long generation;
+  size_t count;
+  size_t capacity;
+  TraceEvent* events;
+} trace = {NULL, GAME_TRACE_CHROME, 0, 0.0, 0, 0, 0, NULL};
+
+static const char* const DIRECTION_NAMES[TRACE_DIRECTIONS] = {
+  "halo from south", "halo from south east", "halo from south west",
+  "halo from north", "halo from north east", "halo from north west",
+  "halo from west", "halo from east"
+};
+
+static const char* const SYNC_NAMES[TRACE_SYNCS] = {
+  "shared barrier", "window complete", "window wait", "neighbor exchange"
+};
+
+static inline void record(
+  const enum TraceKind kind, const unsigned long long value,
+  const double begin, const double end)
+{
+  if (trace.events == NULL) {
+    return;
+  }
+
+  if (trace.count == trace.capacity) {
+    trace.capacity *= 2;
+    trace.events = (TraceEvent*)realloc(trace.events, trace.capacity * sizeof(TraceEvent));
+  }
+
+  TraceEvent* const event = &trace.events[trace.count++];
+  event->begin = begin;
+  event->end = end;
+  event->generation = trace.generation;
+  event->value = value;
+  event->kind = kind;
+}
+
+void trace_start(const GameOptions* const options, const GameInfo* const game)
+{
+  if (options->trace_path == NULL) {
+    return;
+  }
+
+  trace.prefix = options->trace_path;
+  trace.format = options->trace_format;
+  trace.rank = game->rank;
+  trace.generation = 0;
+  trace.count = 0;
+  trace.capacity = 1024;
+  trace.events = (TraceEvent*)malloc(trace.capacity * sizeof(TraceEvent));
+
+  MPI_Barrier(game->communicator);
+  trace.origin = MPI_Wtime();
+}
+
+void trace_generation(const long generation)
+{
+  trace.generation = generation;
+}
+
+void trace_phase(const int phase, const double begin, const double end)
+{
+  record(TRACE_PHASE_EVENT, phase, begin, end);
+}
+
+void trace_population(GameInfo* const game)
+{
+  if (trace.events == NULL) {
+    return;
+  }
+
+  const unsigned long long live = local_population(game);
+  const double now = MPI_Wtime();
+  record(TRACE_POPULATION_EVENT, live, now, now);
+}
+
+void trace_sync(const enum TraceSync sync, const double begin, const double end)
+{
+  record(TRACE_SYNC_EVENT, sync, begin, end);
+}
+
+// Sends and receives complete in any order. The receive of each direction
+// is timed from the start of the wait.
+void trace_waitall(
+  const int count, MPI_Request* const request, MPI_Status* const status,
+  const int* const directions)
+{
+  if (trace.events == NULL) {
+    MPI_Waitall(count, request, status);
+    return;
+  }
+
+  const double begin = MPI_Wtime();
+  for (int i = 0; i < count; i++) {
+    int index;
+    MPI_Status done;
+    MPI_Waitany(count, request, &index, &done);
+    if (index == MPI_UNDEFINED) {
+      break;
+    }
+
+    if (status != MPI_STATUSES_IGNORE) {
+      status[index] = done;
+    }
+    if (index % 2 == 1) {
+      const int direction = directions != NULL ? directions[index / 2] : index / 2;
+      record(TRACE_DIRECTION_EVENT, direction, begin, MPI_Wtime());
+    }
+  }
+}
+
+static inline const char* event_name(const TraceEvent* const event)
+{
+  switch (event->kind) {
+    case TRACE_PHASE_EVENT:
+      return PHASE_NAMES[event->value];
+    case TRACE_DIRECTION_EVENT:
+      return DIRECTION_NAMES[event->value];
+    case TRACE_SYNC_EVENT:
+      return SYNC_NAMES[event->value];
+    default:
+      return "live cells";
+  }
+}
+
+// One process per rank, phases on the first thread and halo waits and
+// synchronizations on the second, live cells as a counter. Times are in microseconds.
+static void write_chrome(FILE* const file)
+{
+  fprintf(file, "{\"traceEvents\":[\n");
+  fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}}",
+          trace.rank, trace.rank);
+
+  for (size_t i = 0; i < trace.count; i++) {
+    const TraceEvent* const event = &trace.events[i];
+    const double begin = 1e6 * (event->begin - trace.origin);
+
+    if (event->kind == TRACE_POPULATION_EVENT) {
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,"
+                    "\"args\":{\"live\":%llu}}",
+              event_name(event), trace.rank, begin, event->value);
+    } else {
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                    "\"dur\":%.3f,\"args\":{\"generation\":%ld}}",
+              event_name(event), trace.rank, event->kind != TRACE_PHASE_EVENT,
+              begin, 1e6 * (event->end - event->begin), event->generation);
+    }
+  }
+
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+// One row per event, times in seconds
+static void write_csv(FILE* const file)
+{
+  fprintf(file, "rank,generation,event,begin,end,live\n");
+
+  for (size_t i = 0; i < trace.count; i++) {
+    const TraceEvent* const event = &trace.events[i];
+    fprintf(file, "%d,%ld,%s,%.9f,%.9f,", trace.rank, event->generation, event_name(event),
+            event->begin - trace.origin, event->end - trace.origin);
+    if (event->kind == TRACE_POPULATION_EVENT) {
+      fprintf(file, "%llu", event->value);
+    }
+    fprintf(file, "\n");
+  }
+}
+
+int trace_finish(void)
+{
+  if (trace.events == NULL) {
+    return 0;
+  }
+
+  char* const path = (char*)malloc(strlen(trace.prefix) + 32);
+  sprintf(path, "%s%d.%s", trace.prefix, trace.rank,
+          trace.format == GAME_TRACE_CSV ? "csv" : "json");
+
+  int ierror = 1;
+  FILE* const file = fopen(path, "w");
+  if (file != NULL) {
+    if (trace.format == GAME_TRACE_CSV) {
+      write_csv(file);
+    } else {
+      write_chrome(file);
+    }
+    ierror = fclose(file) != 0;
+  }
+  free(path);
+
+  free(trace.events);
+  trace.events = NULL;
+  return ierror;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mpi.h>
+
+#include "initialize_game.h"
+#include "options_game.h"
+
+// Opt-in instrumentation for finding stragglers, built with -DGAME_TRACE
+// (make TRACE=1) and enabled with --trace=PREFIX. Every rank records the
+// begin and end of each phase of every generation, the wait for the halo of
+// each of the eight exchange directions, or the barrier, epoch or collective
+// the halo exchange waits for, and its live cells per generation,
+// and writes them to PREFIX<rank>.json as a Chrome trace (chrome://tracing
+// or Perfetto) or to PREFIX<rank>.csv. Timestamps count from a barrier at
+// the start, so the files of all ranks line up.
+//
+// Without GAME_TRACE the TRACE_* macros expand to nothing and the hot paths
+// carry no instrumentation at all.
+
+// Direction i is the exchange pair i of the derived exchange, named after
+// the neighbour whose halo it receives
+#define TRACE_DIRECTIONS 8
+
+// Halo synchronizations that aren't a receive of one direction
+enum TraceSync {
+  TRACE_SHARED_BARRIER,     // node neighbours wrote or read the shared tiles
+  TRACE_WINDOW_COMPLETE,    // RMA access epoch, our puts are done
+  TRACE_WINDOW_WAIT,        // RMA exposure epoch, the neighbours' puts are done
+  TRACE_NEIGHBOR_EXCHANGE,  // the neighborhood collective of all directions
+  TRACE_SYNCS
+};
+
+#ifdef GAME_TRACE
+
+void trace_start(const GameOptions* const options, const GameInfo* const game);
+void trace_generation(const long generation);
+void trace_phase(const int phase, const double begin, const double end);
+void trace_population(GameInfo* const game);
+void trace_sync(const enum TraceSync sync, const double begin, const double end);
+
+// Requests come in send and receive pairs, pair i exchanges the direction
+// directions[i], or direction i without directions
+void trace_waitall(const int count, MPI_Request* const request, MPI_Status* const status,
+                   const int* const directions);
+
+// Write the trace of this rank and drop it, nonzero if the file can't be
+// written
+int trace_finish(void);
+
+#define TRACE_START(options, game) trace_start(options, game)
+#define TRACE_GENERATION(generation) trace_generation(generation)
+#define TRACE_PHASE(phase, begin, end) trace_phase(phase, begin, end)
+#define TRACE_POPULATION(game) trace_population(game)
+#define TRACE_WAITALL(count, request, status, directions) \
+  trace_waitall(count, request, status, directions)
+#define TRACE_SYNC(sync, ...) do {                 \
+    const double trace_begin = MPI_Wtime();         \
+    __VA_ARGS__;                                    \
+    trace_sync(sync, trace_begin, MPI_Wtime());     \
+  } while (0)
+#define TRACE_FINISH() trace_finish()
+
+#else
+
+#define TRACE_START(options, game) ((void)0)
+#define TRACE_GENERATION(generation) ((void)0)
+#define TRACE_PHASE(phase, begin, end) ((void)0)
+#define TRACE_POPULATION(game) ((void)0)
+#define TRACE_WAITALL(count, request, status, directions) MPI_Waitall(count, request, status)
+#define TRACE_SYNC(sync, ...) __VA_ARGS__
+#define TRACE_FINISH() 0
+
+#endif
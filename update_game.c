@@ -1,10 +1,21 @@
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 
 #include "initialize_game.h"
+#include "packed_game.h"
+#include "sparse_game.h"
+#include "synchronize_game.h"
 #include "update_game.h"
 
+// Cells updated between two progress calls on outstanding halo messages
+#define INTERIOR_BAND_CELLS 65536
+
+// Regions smaller than this are updated by the calling thread alone
+#define PARALLEL_MIN_CELLS 16384
+
 static inline void swap_arrays(bool* restrict * array_a, bool* restrict * array_b)
 {
   bool* temp = *array_a;
@@ -12,26 +23,229 @@ static inline void swap_arrays(bool* restrict * array_a, bool* restrict * array_
   *array_b = temp;
 }
 
-void update_game(GameInfo* game)
+static inline void swap_packed_arrays(uint64_t* restrict * array_a, uint64_t* restrict * array_b)
+{
+  uint64_t* temp = *array_a;
+  *array_a = *array_b;
+  *array_b = temp;
+}
+
+// Packed counterpart of update_region(), updates rows [row_begin, row_end)
+// and words [word_begin, word_end) of each row with the packed kernel of the
+// rule
+static void update_packed_region(
+  GameInfo* game,
+  const int row_begin, const int row_end,
+  const int word_begin, const int word_end)
+{
+  const PackedKernel kernel = game->packed_kernel;
+  const uint64_t* restrict const current = game->packed_current;
+  uint64_t* restrict const next = game->packed_previouse;
+  const int words = game->packed_cols;
+  const int last_col = game->local_cols + 1;
+  const int cells = (row_end - row_begin) * (word_end - word_begin) * PACKED_WORD_BITS;
+
+  #pragma omp parallel for schedule(static) if (cells >= PARALLEL_MIN_CELLS)
+  for (int r = row_begin; r < row_end; r++) {
+    kernel(current, next, words, last_col, r, r + 1, word_begin, word_end);
+  }
+}
+
+// Generations rules on top of the life-like step of the kernel: dying cells
+// can't be born and age until they are dead, cells that just died start
+// dying. Each cell only looks at itself, so decay is updated in place.
+// Written with byte masks instead of branches, so it vectorizes.
+static inline void decay_row(
+  const uint8_t* restrict const current, uint8_t* restrict const next,
+  uint8_t* restrict const decay, const int states,
+  const int col_begin, const int col_end)
+{
+  const uint8_t dead = states - 1;
+
+  for (int c = col_begin; c < col_end; c++) {
+    const uint8_t age = decay[c];
+    const uint8_t dying = -(uint8_t)(age != 0);
+    const uint8_t older = (uint8_t)(age + 1) & -(uint8_t)(age + 1 != dead);
+    decay[c] = (older & dying) | (current[c] & ~next[c] & ~dying);
+    next[c] = next[c] & ~dying;
+  }
+}
+
+// Run the byte kernel on a region, split into row bands over the threads of
+// the rank. The static schedule hands each thread the same rows every
+// generation, matching the first touch in initialize_game().
+static void update_region(
+  GameInfo* game,
+  const int row_begin, const int row_end,
+  const int col_begin, const int col_end)
 {
-  int cols_pad = game->local_cols + 2;
-  bool* current = game->current;
+  const GameKernel kernel = game->kernel;
+  const uint8_t* restrict const table = game->rule_table;
+  const bool* restrict const current = game->current;
+  bool* restrict const next = game->previouse;
+  uint8_t* restrict const decay = game->decay;
+  const int states = game->rule.states;
+  const int cols_pad = padded_cols(game);
+  const int cells = (row_end - row_begin) * (col_end - col_begin);
 
-  for (int r = 1; r < game->local_rows + 1; r++) {
-    for (int c = 1; c < game->local_cols + 1; c++) {
-      int sum = current[(r - 1) * cols_pad + c - 1] + current[(r - 1) * cols_pad + c + 0] + current[(r - 1) * cols_pad + c + 1]
-              + current[(r + 0) * cols_pad + c - 1] +                  0                  + current[(r + 0) * cols_pad + c + 1]
-              + current[(r + 1) * cols_pad + c - 1] + current[(r + 1) * cols_pad + c + 0] + current[(r + 1) * cols_pad + c + 1];
+  #pragma omp parallel for schedule(static) if (cells >= PARALLEL_MIN_CELLS)
+  for (int r = row_begin; r < row_end; r++) {
+    kernel(current, next, cols_pad, table, r, r + 1, col_begin, col_end);
+    if (decay != NULL) {
+      decay_row((const uint8_t*)&current[r * cols_pad], (uint8_t*)&next[r * cols_pad],
+                &decay[r * cols_pad], states, col_begin, col_end);
+    }
+  }
+}
+
+// Update the active blocks only and record which of them changed. Blocks
+// differ a lot in cost, dead ones are quick to compare, hence the dynamic
+// schedule.
+static void update_sparse_region(GameInfo* game)
+{
+  const int active = mark_active_blocks(game);
+  const GameKernel kernel = game->kernel;
+  const bool* restrict const current = game->current;
+  bool* restrict const next = game->previouse;
+  const int cols_pad = padded_cols(game);
+  const int map_cols = game->block_cols + 2;
+
+  #pragma omp parallel for schedule(dynamic) if (active > 1)
+  for (int i = 0; i < active; i++) {
+    const int block_row = game->active_blocks[i] / game->block_cols;
+    const int block_col = game->active_blocks[i] % game->block_cols;
+
+    const int row_begin = 1 + block_row * SPARSE_BLOCK;
+    const int col_begin = 1 + block_col * SPARSE_BLOCK;
+    const int row_end = row_begin + SPARSE_BLOCK < game->local_rows + 1 ?
+                        row_begin + SPARSE_BLOCK : game->local_rows + 1;
+    const int col_end = col_begin + SPARSE_BLOCK < game->local_cols + 1 ?
+                        col_begin + SPARSE_BLOCK : game->local_cols + 1;
+
+    kernel(current, next, cols_pad, game->rule_table, row_begin, row_end, col_begin, col_end);
+
+    bool changed = false;
+    for (int r = row_begin; r < row_end && !changed; r++) {
+      changed = memcmp(&current[r * cols_pad + col_begin], &next[r * cols_pad + col_begin],
+                       (col_end - col_begin) * sizeof(bool)) != 0;
+    }
+    game->block_changed[(block_row + 1) * map_cols + block_col + 1] = changed;
+  }
+}
+
+// Rows 2 .. local_rows - 1 and columns 2 .. local_cols - 1 don't read any
+// halo cells. For packed tiles the first word holds column 1 and the words
+// from local_cols / 64 on hold column local_cols, so those count as border.
+static inline int packed_interior_end(const GameInfo* const game)
+{
+  return game->local_cols / PACKED_WORD_BITS;
+}
+
+void update_game_interior(GameInfo* game)
+{
+  const int rows = game->local_rows;
+  const int cols = game->local_cols;
 
-      // Update previouse array, later previouse and current will be swapped
-      if (sum == 3 || (sum == 2 && current[r * cols_pad + c] == 1)) {
-        game->previouse[r * cols_pad + c] = 1;
-      } else {
-        game->previouse[r * cols_pad + c] = 0;
+  if (rows <= 2 || cols <= 2) {
+    return;
+  }
+
+  // Compute in bands so the outstanding halo messages can progress
+  const int band = INTERIOR_BAND_CELLS / cols + 1;
+
+  for (int r = 2; r < rows; r += band) {
+    const int band_end = r + band < rows ? r + band : rows;
+
+    if (game->storage == GAME_STORAGE_PACKED) {
+      update_packed_region(game, r, band_end, 1, packed_interior_end(game));
+    } else {
+      update_region(game, r, band_end, 2, cols);
+    }
+
+    progress_synchronize_game(game);
+  }
+}
+
+void update_game_border(GameInfo* game)
+{
+  const int rows = game->local_rows;
+  const int cols = game->local_cols;
+
+  if (game->storage == GAME_STORAGE_PACKED) {
+    const int words = game->packed_cols;
+    const int interior_end = packed_interior_end(game);
+
+    update_packed_region(game, 1, 2, 0, words);
+    if (rows > 1) {
+      update_packed_region(game, rows, rows + 1, 0, words);
+    }
+    if (rows > 2) {
+      update_packed_region(game, 2, rows, 0, interior_end > 1 ? 1 : words);
+      if (interior_end > 1) {
+        update_packed_region(game, 2, rows, interior_end, words);
       }
     }
+
+    swap_packed_arrays(&game->packed_current, &game->packed_previouse);
+    game->halo_age++;
+    return;
+  }
+
+  // north and south rows
+  update_region(game, 1, 2, 1, cols + 1);
+  if (rows > 1) {
+    update_region(game, rows, rows + 1, 1, cols + 1);
+  }
+
+  // west and east columns, the corners belong to the rows above
+  if (rows > 2) {
+    update_region(game, 2, rows, 1, 2);
+    if (cols > 1) {
+      update_region(game, 2, rows, cols, cols + 1);
+    }
   }
 
   // Now make previouse the current
   swap_arrays(&game->current, &game->previouse);
+  game->halo_age++;
+}
+
+// Number of extra rings to update beyond the tile on a side with the given
+// neighbour. Sides without a neighbour are never expanded, so their halos
+// stay dead.
+static inline int halo_extent(const GameInfo* const game, const int neighbour)
+{
+  return neighbour == MPI_PROC_NULL ? 0 : game->halo - 1 - game->halo_age;
+}
+
+void update_game(GameInfo* game)
+{
+  if (game->storage == GAME_STORAGE_PACKED) {
+    update_packed_region(game, 1, game->local_rows + 1, 0, game->packed_cols);
+    swap_packed_arrays(&game->packed_current, &game->packed_previouse);
+    game->halo_age++;
+    return;
+  }
+
+  if (game->sparse) {
+    update_sparse_region(game);
+    swap_arrays(&game->current, &game->previouse);
+    game->halo_age++;
+    return;
+  }
+
+  // With deep halos one exchange is valid for halo generations. Each
+  // generation uses up one ring of the halo, so the tile and the rings that
+  // are still needed by the following generations are updated together.
+  const struct Topology* const topology = &game->topology;
+  const int halo = game->halo;
+
+  update_region(game, halo - halo_extent(game, topology->north.rank),
+                halo + game->local_rows + halo_extent(game, topology->south.rank),
+                halo - halo_extent(game, topology->west.rank),
+                halo + game->local_cols + halo_extent(game, topology->east.rank));
+
+  // Now make previouse the current
+  swap_arrays(&game->current, &game->previouse);
+  game->halo_age++;
 }
@@ -4,4 +4,15 @@
 
 #include "initialize_game.h"
 
+// Update the full tile and make the result the current generation. With a
+// halo width above one this can be repeated until halo_expired() says that
+// the halos must be synchronized again.
 void update_game(GameInfo* game);
+
+// Split update for overlapping with the halo exchange, only for a halo width
+// of one. The interior only reads cells of the tile itself and can run
+// between start and finish of the exchange. The border ring needs the halos
+// and completes the generation, like update_game() it swaps current and
+// previouse.
+void update_game_interior(GameInfo* game);
+void update_game_border(GameInfo* game);